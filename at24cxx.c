@@ -14,32 +14,172 @@
 #include <lib/delay.h>
 
 
-uint32_t at24cxx_read(at24cxx_t *at24cxx,
-    uint32_t addr, uint8_t *buff, uint32_t size)
+// at24c04/08/16: word address bits 8~10 go into the device address.
+static inline uint8_t dev_addr(at24cxx_t *at24cxx, uint32_t addr)
+{
+    return at24cxx->address | ((addr >> 8) & 0x07);
+}
+
+// Polls take 10 clocks at least, 1000 of them outlast tWR (5ms) at 1MHz.
+#define ACK_POLL_MAX 1000
+
+// Wait for the inner write cycle of the last page write.
+static int wait_ready(at24cxx_t *at24cxx)
+{
+    uint32_t timeout = ACK_POLL_MAX;
+
+    if (!at24cxx->writing) {
+        return 1;
+    }
+
+    if (at24cxx->ack_polling) {
+        // the device does not acknowledge its address while busy
+        do {
+            i2c_start(at24cxx->i2c);
+            if (i2c_7b_addr(at24cxx->i2c, 
+                dev_addr(at24cxx, at24cxx->cur_addr), 0)) {
+                break;
+            }
+        } while (--timeout);
+        i2c_stop(at24cxx->i2c);
+        if (!timeout) {
+            return 0;
+        }
+    }
+    else {
+		// at24cxx inner delay, see datasheet.
+        delay_ms(5);
+    }
+
+    at24cxx->writing = 0;
+
+    return 1;
+}
+
+// Wait for an asynchronous read, at most about twice its transfer time at 
+// 100kHz (9 clocks per byte, 90us): 180us per byte.
+static int wait_read(at24cxx_t *at24cxx)
 {
-    int i = 0;
+    uint32_t timeout = at24cxx->rd_size * 18 / 100 + 10; // ms
+
+    while (at24cxx->reading && timeout--) {
+        delay_ms(1);
+    }
+
+    return !at24cxx->reading;
+}
+
+int at24cxx_read_async(at24cxx_t *at24cxx, uint32_t addr, 
+    uint8_t *buff, uint32_t size, at24cxx_callback_t callback)
+{
+    uint32_t i = 0;
     
     
-//	while (i2c_busy(at24cxx->i2c));
+    if (!wait_read(at24cxx)) {
+        return 0;
+    }
 	
-    if (size > 0) {
-        i2c_start(at24cxx->i2c);
-        i2c_7b_addr(at24cxx->i2c, at24cxx->address, 0);
+    if (size == 0) {
+        return 0;
+    }
+
+    if (!wait_ready(at24cxx)) {
+        return 0;
+    }
+
+    i2c_start(at24cxx->i2c);
+    // Current address read when the inner address counter is already 
+    // there, otherwise random read (dummy write of the word address).
+    if (!(at24cxx->cur_valid && at24cxx->cur_addr == addr)) {
+        i2c_7b_addr(at24cxx->i2c, dev_addr(at24cxx, addr), 0);
         i2c_write(at24cxx->i2c, addr);
         i2c_start(at24cxx->i2c);
-        i2c_7b_addr(at24cxx->i2c, at24cxx->address, 1);
-        
-        for (i = 0; i < size-1; ++i) {
-            buff[i] = i2c_read(at24cxx->i2c, 1);
-        }
-        buff[i] = i2c_read(at24cxx->i2c, 0);
-        
-        i2c_stop(at24cxx->i2c); // stop condition
+    }
+    i2c_7b_addr(at24cxx->i2c, dev_addr(at24cxx, addr), 1);
+
+    at24cxx->cur_valid = 0;
+    at24cxx->rd_addr = addr;
+    at24cxx->rd_size = size;
+    at24cxx->rd_callback = callback;
+    at24cxx->reading = 1;
+
+    if (at24cxx->recv && at24cxx->recv(at24cxx, buff, size)) {
+        return 1;
+    }
+
+    for (i = 0; i < size-1; ++i) {
+        buff[i] = i2c_read(at24cxx->i2c, 1);
+    }
+    buff[i] = i2c_read(at24cxx->i2c, 0);
+    
+    i2c_stop(at24cxx->i2c); // stop condition
+
+    at24cxx_read_done(at24cxx);
+
+    return 1;
+}
+
+void at24cxx_read_done(at24cxx_t *at24cxx)
+{
+    // Sequential read rolls over from the last byte to the first one.
+    at24cxx->cur_addr = (at24cxx->rd_addr + at24cxx->rd_size) 
+        % at24cxx->capacity;
+    at24cxx->cur_valid = 1;
+    at24cxx->reading = 0;
+
+    if (at24cxx->rd_callback) {
+        at24cxx->rd_callback(at24cxx, at24cxx->rd_size);
+    }
+}
+
+uint32_t at24cxx_read(at24cxx_t *at24cxx,
+    uint32_t addr, uint8_t *buff, uint32_t size)
+{
+    if (!at24cxx_read_async(at24cxx, addr, buff, size, 0)) {
+        return 0;
+    }
+
+    if (!wait_read(at24cxx)) {
+        return 0;
     }
     
     return size;
 }
 
+// Write inside one page, without waiting for the inner write cycle.
+static int page_write(at24cxx_t *at24cxx,
+    uint32_t addr, uint8_t *data, uint32_t size)
+{
+    uint32_t wc;
+
+    // an asynchronous read still owns the bus
+    if (!wait_read(at24cxx)) {
+        return 0;
+    }
+
+    if (!wait_ready(at24cxx)) {
+        return 0;
+    }
+
+    i2c_start(at24cxx->i2c);
+    i2c_7b_addr(at24cxx->i2c, dev_addr(at24cxx, addr), 0);
+    i2c_write(at24cxx->i2c, addr);
+
+    for (wc = 0; wc < size; ++wc) {
+        i2c_write(at24cxx->i2c, *data++);
+    }
+
+    i2c_stop(at24cxx->i2c);
+
+    // Page write only increments the lower address bits.
+    at24cxx->cur_addr = ((addr & ~(at24cxx->page_size-1))
+        | ((addr + wc) & (at24cxx->page_size-1))) % at24cxx->capacity;
+    at24cxx->cur_valid = 1;
+    at24cxx->writing = 1;
+
+    return 1;
+}
+
 uint32_t at24cxx_write(at24cxx_t *at24cxx,
     uint32_t addr, uint8_t *data, uint32_t size)
 {
@@ -48,32 +188,278 @@ uint32_t at24cxx_write(at24cxx_t *at24cxx,
     int wc = 0;
     
     
-//	while (i2c_busy(at24cxx->i2c));
-	
     while (size > 0) {
         poffset = addr & (at24cxx->page_size-1);
         wc = size < at24cxx->page_size-poffset ? 
             size : at24cxx->page_size-poffset;
 
-        i2c_start(at24cxx->i2c);
-        i2c_7b_addr(at24cxx->i2c, at24cxx->address, 0);
-        i2c_write(at24cxx->i2c, addr);
+        if (!page_write(at24cxx, addr, data, wc)) {
+            break;
+        }
         
         twc += wc;
         addr += wc;
+        data += wc;
         size -= wc;
-        
-        while (wc-- > 0) {
-            i2c_write(at24cxx->i2c, *data++);
-        }
-        
-        i2c_stop(at24cxx->i2c);
-        
-		// at24cxx inner delay, see datasheet.
-        delay_ms(5);
+    }
+
+    // With ack polling the last write cycle is left to the next access.
+    if (!at24cxx->ack_polling) {
+        wait_ready(at24cxx);
     }
     
     return twc;
 }
 
+
+void at24cxx_seek(at24cxx_t *at24cxx, uint32_t addr)
+{
+    at24cxx->cursor = addr % at24cxx->capacity;
+}
+
+uint32_t at24cxx_read_next(at24cxx_t *at24cxx, uint8_t *buff, uint32_t size)
+{
+    size = at24cxx_read(at24cxx, at24cxx->cursor, buff, size);
+    at24cxx->cursor = (at24cxx->cursor + size) % at24cxx->capacity;
+    return size;
+}
+
+
+
+// -----------------------------------------------------------------------------
+// array
+int at24cxx_array_init(at24cxx_array_t *array)
+{
+    uint32_t i;
+
+    if (array->count == 0) {
+        return 0;
+    }
+
+    for (i = 1; i < array->count; ++i) {
+        if (array->chips[i].page_size != array->chips[0].page_size
+            || array->chips[i].capacity != array->chips[0].capacity) {
+            return 0;
+        }
+    }
+
+    array->page_size = array->chips[0].page_size;
+    array->capacity = array->chips[0].capacity * array->count;
+
+    return 1;
+}
+
+// Pages are striped over the chips: linear page p lives on chip p%count.
+static at24cxx_t *array_locate(at24cxx_array_t *array,
+    uint32_t addr, uint32_t *local)
+{
+    uint32_t page = addr / array->page_size;
+
+    *local = (page / array->count) * array->page_size
+        + (addr & (array->page_size-1));
+
+    return &array->chips[page % array->count];
+}
+
+uint32_t at24cxx_array_read(at24cxx_array_t *array,
+    uint32_t addr, uint8_t *buff, uint32_t size)
+{
+    uint32_t poffset, local, wc;
+    uint32_t trc = 0;
+    at24cxx_t *chip;
+
+    while (size > 0) {
+        poffset = addr & (array->page_size-1);
+        wc = size < array->page_size-poffset ?
+            size : array->page_size-poffset;
+
+        chip = array_locate(array, addr, &local);
+        if (at24cxx_read(chip, local, buff, wc) != wc) {
+            break;
+        }
+
+        trc += wc;
+        addr += wc;
+        buff += wc;
+        size -= wc;
+    }
+
+    return trc;
+}
+
+uint32_t at24cxx_array_write(at24cxx_array_t *array,
+    uint32_t addr, uint8_t *data, uint32_t size)
+{
+    uint32_t poffset, local, wc, i;
+    uint32_t twc = 0;
+    at24cxx_t *chip;
+
+    while (size > 0) {
+        // Consecutive pages are on different chips, so a round writes at 
+        // most one page per chip and all their write cycles run together.
+        for (i = 0; i < array->count && size > 0; ++i) {
+            poffset = addr & (array->page_size-1);
+            wc = size < array->page_size-poffset ?
+                size : array->page_size-poffset;
+
+            chip = array_locate(array, addr, &local);
+            if (!page_write(chip, local, data, wc)) {
+                return twc;
+            }
+
+            twc += wc;
+            addr += wc;
+            data += wc;
+            size -= wc;
+        }
+
+        // One delay for the whole round, ack polling chips are polled
+        // before their next access.
+        for (i = 0; i < array->count; ++i) {
+            if (array->chips[i].writing && !array->chips[i].ack_polling) {
+                break;
+            }
+        }
+        if (i < array->count) {
+            delay_ms(5);
+            for (i = 0; i < array->count; ++i) {
+                if (!array->chips[i].ack_polling) {
+                    array->chips[i].writing = 0;
+                }
+            }
+        }
+    }
+
+    return twc;
+}
+
+
+
+// -----------------------------------------------------------------------------
+// record
+// slot: | seq(2) | sum(1) | data(slot_size-3) |
+#define RECORD_HEADER_SIZE 3
+
+static uint8_t record_sum(uint8_t *slot, uint32_t size)
+{
+    uint8_t sum = 0xA5;
+    uint32_t i;
+
+    for (i = 0; i < size; ++i) {
+        if (i != 2) {
+            sum += slot[i];
+        }
+    }
+
+    return ~sum;
+}
+
+static uint16_t record_seq(at24cxx_record_t *rec, uint32_t slot)
+{
+    uint8_t seq[2];
+
+    at24cxx_read(rec->at24cxx, rec->base + slot * rec->slot_size, seq, 2);
+
+    return seq[0] | (seq[1] << 8);
+}
+
+static int record_check(at24cxx_record_t *rec, uint32_t slot, uint8_t *buff)
+{
+    at24cxx_read(rec->at24cxx, rec->base + slot * rec->slot_size,
+        buff, rec->slot_size);
+
+    return buff[2] == record_sum(buff, rec->slot_size);
+}
+
+int at24cxx_record_init(at24cxx_record_t *rec)
+{
+    uint8_t buff[AT24CXX_RECORD_SLOT_MAX];
+    uint32_t lo, hi, mid;
+    uint16_t seq0;
+
+    if (rec->slot_count == 0 
+        || rec->slot_size <= RECORD_HEADER_SIZE
+        || rec->slot_size > AT24CXX_RECORD_SLOT_MAX
+        || rec->base + rec->slot_count * rec->slot_size 
+            > rec->at24cxx->capacity) {
+        return 0;
+    }
+
+    // Slots are written in turn with seq+1 each, so seq(i)-seq(0) == i 
+    // holds up to the newest slot and breaks right after it: binary search 
+    // it by reading only the sequence numbers.
+    seq0 = record_seq(rec, 0);
+    lo = 0;
+    hi = rec->slot_count;
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if ((uint16_t)(record_seq(rec, mid) - seq0) == mid) {
+            lo = mid;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    // The newest slot may be a torn write, fall back to the one before.
+    rec->valid = 1;
+    if (!record_check(rec, lo, buff)) {
+        lo = (lo + rec->slot_count - 1) % rec->slot_count;
+        if (!record_check(rec, lo, buff)) {
+            rec->valid = 0;
+        }
+    }
+
+    if (rec->valid) {
+        rec->current = lo;
+        rec->seq = buff[0] | (buff[1] << 8);
+    }
+    else {
+        rec->current = rec->slot_count - 1;
+        rec->seq = 0xFFFF;
+    }
+
+    return 1;
+}
+
+uint32_t at24cxx_record_read(at24cxx_record_t *rec, uint8_t *buff)
+{
+    if (!rec->valid) {
+        return 0;
+    }
+
+    return at24cxx_read(rec->at24cxx, 
+        rec->base + rec->current * rec->slot_size + RECORD_HEADER_SIZE,
+        buff, rec->slot_size - RECORD_HEADER_SIZE);
+}
+
+uint32_t at24cxx_record_write(at24cxx_record_t *rec, uint8_t *data)
+{
+    uint8_t buff[AT24CXX_RECORD_SLOT_MAX];
+    uint32_t slot;
+    uint16_t seq;
+    uint32_t i;
+
+    slot = (rec->current + 1) % rec->slot_count;
+    seq = rec->seq + 1;
+
+    buff[0] = seq & 0xFF;
+    buff[1] = seq >> 8;
+    for (i = RECORD_HEADER_SIZE; i < rec->slot_size; ++i) {
+        buff[i] = *data++;
+    }
+    buff[2] = record_sum(buff, rec->slot_size);
+
+    if (at24cxx_write(rec->at24cxx, rec->base + slot * rec->slot_size, 
+        buff, rec->slot_size) != rec->slot_size) {
+        return 0;
+    }
+
+    rec->current = slot;
+    rec->seq = seq;
+    rec->valid = 1;
+
+    return rec->slot_size - RECORD_HEADER_SIZE;
+}
+
 /****************************** Copy right 2019 *******************************/
@@ -15,18 +15,102 @@
 
 #include <i2c.h>
 
-typedef struct 
+typedef struct at24cxx
 {
     i2c_t *i2c;
     uint32_t page_size; // Byte
     uint32_t address;
     uint32_t capacity; // Byte
+    // wait write cycles by polling the device address ack instead of a 
+    // fixed delay, i2c_7b_addr() must return the ack state. The access 
+    // fails if the device does not answer 1000 polls.
+    uint8_t ack_polling:1;
+    //
+    uint32_t cursor; // at24cxx_read_next position
+    uint32_t cur_addr; // device inner address counter, valid if cur_valid
+    uint8_t cur_valid:1;
+    uint8_t writing:1; // write cycle may be in progress
+
+    // machine-dependent, optional. Start an interrupt/DMA driven reception 
+    // of size bytes (NACK the last one, then stop condition) and return 1 
+    // at once, at24cxx_read_done() must be called on completion. Return 0 
+    // to fall back to the blocking byte loop.
+    int (*recv)(struct at24cxx *at24cxx, uint8_t *buff, uint32_t size);
+
+    // internal-use
+    volatile uint8_t reading;
+    uint32_t rd_addr;
+    uint32_t rd_size;
+    void (*rd_callback)(struct at24cxx *at24cxx, uint32_t size);
 } at24cxx_t;
 
+typedef void (*at24cxx_callback_t)(at24cxx_t *at24cxx, uint32_t size);
+
 uint32_t at24cxx_read(at24cxx_t *at24cxx,
     uint32_t addr, uint8_t *buff, uint32_t size);
 uint32_t at24cxx_write(at24cxx_t *at24cxx,
     uint32_t addr, uint8_t *data, uint32_t size);
+// asynchronous read: returns once the transfer is started, callback (may 
+// be null) runs in the completion context; poll with at24cxx_busy(). The
+// other calls wait for it and fail if it is not done in about twice its 
+// transfer time at 100kHz, 180us per byte.
+int at24cxx_read_async(at24cxx_t *at24cxx, uint32_t addr, 
+    uint8_t *buff, uint32_t size, at24cxx_callback_t callback);
+void at24cxx_read_done(at24cxx_t *at24cxx);
+static inline int at24cxx_busy(at24cxx_t *at24cxx)
+{
+    return at24cxx->reading;
+}
+// streaming read: sequential reads skip the word address write.
+void at24cxx_seek(at24cxx_t *at24cxx, uint32_t addr);
+uint32_t at24cxx_read_next(at24cxx_t *at24cxx, uint8_t *buff, uint32_t size);
+
+
+
+// -----------------------------------------------------------------------------
+// array: several at24cxx with the same geometry on one bus, seen as one 
+// linear address space. Pages are striped over the chips, so a sequential
+// write overlaps the inner write cycle of every chip.
+typedef struct
+{
+    at24cxx_t *chips;
+    uint32_t count;
+    //
+    uint32_t page_size; // Byte
+    uint32_t capacity; // Byte
+} at24cxx_array_t;
+
+int at24cxx_array_init(at24cxx_array_t *array);
+uint32_t at24cxx_array_read(at24cxx_array_t *array,
+    uint32_t addr, uint8_t *buff, uint32_t size);
+uint32_t at24cxx_array_write(at24cxx_array_t *array,
+    uint32_t addr, uint8_t *data, uint32_t size);
+
+
+
+// -----------------------------------------------------------------------------
+// record: wear leveling for small, frequently updated data (counters...).
+// Every update goes to the next slot of the region with a sequence number,
+// so the writes are spread over slot_count slots. Keep slot_size a divisor 
+// of page_size to cost one write cycle per update.
+#define AT24CXX_RECORD_SLOT_MAX 64 // Byte, header included
+typedef struct
+{
+    at24cxx_t *at24cxx;
+    uint32_t base; // Byte
+    uint32_t slot_size; // Byte, 3-byte header included
+    uint32_t slot_count;
+    //
+    uint32_t current; // newest slot
+    uint16_t seq;
+    uint8_t valid:1;
+} at24cxx_record_t;
+
+// find the newest slot
+int at24cxx_record_init(at24cxx_record_t *rec);
+// read/write slot_size-3 bytes
+uint32_t at24cxx_record_read(at24cxx_record_t *rec, uint8_t *buff);
+uint32_t at24cxx_record_write(at24cxx_record_t *rec, uint8_t *data);
 
 #endif /* AT24CXX_H_ */
 
@@ -0,0 +1,396 @@
+/**
+  ******************************************************************************
+  * \brief      host-side at24cxx benchmark
+  * \file       at24cxx_bench.c
+  * \author     doerthous
+  * \date       2026-10-19
+  * \details    Runs at24cxx_test.c and compares access strategies on the 
+  *             simulated bus, reporting simulated bytes/s and bus traffic.
+  *             gcc -I. -Iat24cxx/host at24cxx.c at24cxx_test.c 
+  *                 at24cxx/host/at24cxx_sim.c at24cxx/host/at24cxx_bench.c
+  ******************************************************************************
+  */
+
+#include "at24cxx.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int at24cxx_test(at24cxx_t *at24cxx);
+int at24cxx_cursor_test(at24cxx_t *at24cxx);
+int at24cxx_async_test(at24cxx_t *at24cxx);
+int at24cxx_record_test(at24cxx_record_t *rec);
+int at24cxx_array_test(at24cxx_array_t *array);
+
+
+//#
+// one at24c16: it takes all of 0x50~0x57 for block select
+#define CAPACITY    2048
+#define PAGE_SIZE   16
+// the array: at24c02 parts, A2, A1, A0 strapped to 0~3
+#define CHIPS       4
+#define CHIP_CAPACITY   256
+#define CHIP_PAGE_SIZE  8
+
+static at24cxx_sim_t devs[CHIPS];
+static i2c_t bus = { .devs = devs, .count = 1, .bit_ns = 2500 }; // 400KHz
+static at24cxx_t chips[CHIPS];
+
+static uint8_t data[CAPACITY];
+static uint8_t buff[CAPACITY];
+
+static void setup_parts(int count, uint32_t capacity, uint32_t page_size, 
+    int ack_polling)
+{
+    int i;
+
+    memset(devs, 0xFF, sizeof(devs));
+    memset(chips, 0, sizeof(chips));
+    for (i = 0; i < count; ++i) {
+        devs[i].address = 0x50 + i;
+        devs[i].capacity = capacity;
+        devs[i].page_size = page_size;
+        devs[i].twr_us = 3000;
+        devs[i].counter = 0;
+        devs[i].block = 0;
+        devs[i].busy_until = 0;
+        memset(devs[i].latched, 0, sizeof(devs[i].latched));
+
+        chips[i].i2c = &bus;
+        chips[i].address = devs[i].address;
+        chips[i].capacity = capacity;
+        chips[i].page_size = page_size;
+        chips[i].ack_polling = ack_polling;
+    }
+    bus.count = count;
+    bus.now = 0;
+    bus.starts = bus.bytes = bus.nacks = 0;
+    i2c_sim_clock = &bus;
+
+    for (i = 0; i < (int)sizeof(data); ++i) {
+        data[i] = rand();
+    }
+}
+
+static void setup(int ack_polling)
+{
+    setup_parts(1, CAPACITY, PAGE_SIZE, ack_polling);
+}
+
+static void setup_array(int count, int ack_polling)
+{
+    setup_parts(count, CHIP_CAPACITY, CHIP_PAGE_SIZE, ack_polling);
+}
+
+static void report(const char *name, uint32_t size)
+{
+    double sec = bus.now / 1e9;
+    printf("%-36s %6u B %9.1f ms %9.0f B/s %6u starts %7u bus bytes "
+        "%6u nacks\n", name, size, sec * 1e3, sec > 0 ? size / sec : 0, 
+        bus.starts, bus.bytes, bus.nacks);
+}
+
+static int check(const uint8_t *expect, const uint8_t *got, uint32_t size)
+{
+    if (memcmp(expect, got, size) != 0) {
+        printf("  MISMATCH\n");
+        return 0;
+    }
+    return 1;
+}
+
+
+//#
+static int bench_write(void)
+{
+    int ok = 1;
+
+    setup(0);
+    at24cxx_write(&chips[0], 0, data, CAPACITY);
+    report("write seq, fixed delay", CAPACITY);
+    ok &= check(data, devs[0].mem, CAPACITY);
+
+    setup(1);
+    at24cxx_write(&chips[0], 0, data, CAPACITY);
+    at24cxx_read(&chips[0], 0, buff, 1); // wait for the last write cycle
+    report("write seq, ack polling", CAPACITY);
+    ok &= check(data, devs[0].mem, CAPACITY);
+
+    return ok;
+}
+
+static int bench_small_write(void)
+{
+    uint8_t page[PAGE_SIZE];
+    uint32_t addr, fill;
+    int ok = 1;
+
+    // a 4-byte record each time
+    setup(0);
+    for (addr = 0; addr < CAPACITY; addr += 4) {
+        at24cxx_write(&chips[0], addr, data + addr, 4);
+    }
+    report("write 4B records, fixed delay", CAPACITY);
+    ok &= check(data, devs[0].mem, CAPACITY);
+
+    setup(1);
+    for (addr = 0; addr < CAPACITY; addr += 4) {
+        at24cxx_write(&chips[0], addr, data + addr, 4);
+    }
+    at24cxx_read(&chips[0], 0, buff, 1);
+    report("write 4B records, ack polling", CAPACITY);
+    ok &= check(data, devs[0].mem, CAPACITY);
+
+    // coalesce the records in a page buffer
+    setup(0);
+    fill = 0;
+    for (addr = 0; addr < CAPACITY; addr += 4) {
+        memcpy(page + fill, data + addr, 4);
+        fill += 4;
+        if (fill == PAGE_SIZE) {
+            at24cxx_write(&chips[0], addr + 4 - PAGE_SIZE, page, PAGE_SIZE);
+            fill = 0;
+        }
+    }
+    report("write 4B records, coalesced", CAPACITY);
+    ok &= check(data, devs[0].mem, CAPACITY);
+
+    return ok;
+}
+
+static int bench_read(void)
+{
+    uint32_t addr, i;
+    int ok = 1;
+
+    setup(0);
+    memcpy(devs[0].mem, data, CAPACITY);
+
+    for (addr = 0; addr < CAPACITY; addr += 16) {
+        chips[0].cur_valid = 0; // force random read
+        at24cxx_read(&chips[0], addr, buff + addr, 16);
+    }
+    report("read seq 16B, random read", CAPACITY);
+    ok &= check(data, buff, CAPACITY);
+
+    bus.now = 0;
+    bus.starts = bus.bytes = bus.nacks = 0;
+    at24cxx_seek(&chips[0], 0);
+    for (addr = 0; addr < CAPACITY; addr += 16) {
+        at24cxx_read_next(&chips[0], buff + addr, 16);
+    }
+    report("read seq 16B, current address read", CAPACITY);
+    ok &= check(data, buff, CAPACITY);
+
+    bus.now = 0;
+    bus.starts = bus.bytes = bus.nacks = 0;
+    for (i = 0; i < CAPACITY / 16; ++i) {
+        addr = (rand() % (CAPACITY / 16)) * 16;
+        at24cxx_read(&chips[0], addr, buff, 16);
+        ok &= check(data + addr, buff, 16);
+    }
+    report("read random 16B", CAPACITY);
+
+    bus.now = 0;
+    bus.starts = bus.bytes = bus.nacks = 0;
+    at24cxx_read(&chips[0], 0, buff, CAPACITY);
+    report("read whole device", CAPACITY);
+    ok &= check(data, buff, CAPACITY);
+
+    return ok;
+}
+
+static int bench_array(void)
+{
+    at24cxx_array_t array = { .chips = chips };
+    char name[64];
+    int ok = 1, n, i;
+
+    for (n = 1; n <= CHIPS; n *= 2) {
+        setup_array(n, 0);
+        array.count = n;
+        at24cxx_array_init(&array);
+        at24cxx_array_write(&array, 0, data, array.capacity);
+        snprintf(name, sizeof(name), "array write seq, %d chip(s)", n);
+        report(name, array.capacity);
+
+        at24cxx_array_read(&array, 0, buff, array.capacity);
+        ok &= check(data, buff, array.capacity);
+        for (i = 0; i < n; ++i) {
+            // page p of the array is page p/n of chip p%n
+            ok &= check(data + i * CHIP_PAGE_SIZE, devs[i].mem, 
+                CHIP_PAGE_SIZE);
+        }
+    }
+
+    return ok;
+}
+
+// A transfer that never completes, as a stuck DMA would: writes must give
+// up instead of hanging and leave the devices alone.
+static int stuck_recv(at24cxx_t *at24cxx, uint8_t *buff, uint32_t size)
+{
+    (void)at24cxx;
+    (void)buff;
+    (void)size;
+    return 1;
+}
+
+static int test_stuck_read(void)
+{
+    at24cxx_array_t array = { .chips = chips, .count = 2 };
+    int ok = 1;
+
+    setup_array(2, 0);
+    at24cxx_array_init(&array);
+    chips[0].recv = stuck_recv;
+    ok &= at24cxx_read_async(&chips[0], 0, buff, 64, 0);
+    chips[0].recv = 0;
+
+    ok &= at24cxx_write(&chips[0], 0, data, 8) == 0;
+    ok &= at24cxx_array_write(&array, 0, data, 32) == 0;
+    ok &= devs[0].mem[0] == 0xFF && devs[1].mem[0] == 0xFF;
+    ok &= bus.now < 100000000ull;
+
+    at24cxx_read_done(&chips[0]);
+    ok &= at24cxx_array_write(&array, 0, data, 32) == 32;
+    ok &= at24cxx_array_read(&array, 0, buff, 32) == 32;
+    ok &= check(data, buff, 32);
+
+    return ok;
+}
+
+// A DMA read of the whole device at 100kHz, done in the background: it
+// takes 184ms, a write issued meanwhile waits for it instead of failing.
+static uint8_t *dma_buff;
+static uint64_t dma_done_at;
+
+static void dma_idle(i2c_t *i2c)
+{
+    at24cxx_t *at24cxx = &chips[0];
+    uint32_t i;
+
+    if (!dma_buff || i2c->now < dma_done_at) {
+        return;
+    }
+    for (i = 0; i < at24cxx->rd_size - 1; ++i) {
+        dma_buff[i] = i2c_read(i2c, 1);
+    }
+    dma_buff[i] = i2c_read(i2c, 0);
+    i2c_stop(i2c);
+    dma_buff = 0;
+    at24cxx_read_done(at24cxx);
+}
+
+static int dma_recv(at24cxx_t *at24cxx, uint8_t *buff, uint32_t size)
+{
+    (void)at24cxx;
+    dma_buff = buff;
+    dma_done_at = bus.now + (uint64_t)size * 9 * bus.bit_ns;
+    return 1;
+}
+
+static int test_slow_read(void)
+{
+    int ok = 1;
+
+    setup(0);
+    memcpy(devs[0].mem, data, CAPACITY);
+    bus.bit_ns = 10000;
+    bus.idle = dma_idle;
+    chips[0].recv = dma_recv;
+
+    ok &= at24cxx_read_async(&chips[0], 0, buff, CAPACITY, 0);
+    ok &= at24cxx_write(&chips[0], 0, data + 16, 16) == 16;
+    ok &= !at24cxx_busy(&chips[0]) && check(data, buff, CAPACITY);
+
+    chips[0].recv = 0;
+    bus.idle = 0;
+    bus.bit_ns = 2500;
+    ok &= at24cxx_read(&chips[0], 0, buff, 16) == 16;
+    ok &= check(data + 16, buff, 16);
+
+    return ok;
+}
+
+// The ack polls after a write do not move the inner address counter: a 
+// current address read right after it starts behind the bytes written.
+static int test_poll_then_read(void)
+{
+    int ok = 1;
+
+    setup(1);
+    memcpy(devs[0].mem, data, CAPACITY);
+    ok &= at24cxx_write(&chips[0], 0x100, data + 0x100, 7) == 7;
+    ok &= chips[0].cur_valid && chips[0].cur_addr == 0x107;
+    bus.starts = 0;
+    ok &= at24cxx_read(&chips[0], 0x107, buff, 9) == 9;
+    // the polls, the one acknowledged, the read: no dummy write
+    ok &= bus.nacks > 0 && bus.starts == bus.nacks + 2;
+    ok &= check(data + 0x107, buff, 9);
+
+    return ok;
+}
+
+// A device that stops answering after a write: ack polling gives up.
+static int test_no_ack(void)
+{
+    int ok = 1;
+
+    setup(1);
+    ok &= at24cxx_write(&chips[0], 0, data, 16) == 16;
+    bus.count = 0;
+    ok &= at24cxx_read(&chips[0], 0, buff, 16) == 0;
+    ok &= bus.now < 100000000ull;
+
+    bus.count = 1;
+    ok &= at24cxx_read(&chips[0], 0, buff, 16) == 16;
+    ok &= check(data, buff, 16);
+
+    return ok;
+}
+
+static int run_tests(void)
+{
+    at24cxx_record_t rec = {
+        .at24cxx = &chips[0], .base = 256, .slot_size = 8, .slot_count = 64,
+    };
+    at24cxx_array_t array = { .chips = chips, .count = CHIPS };
+    int ok = 1;
+
+    setup(0);
+    ok &= at24cxx_test(&chips[0]);
+    ok &= at24cxx_cursor_test(&chips[0]);
+    ok &= at24cxx_async_test(&chips[0]);
+    ok &= at24cxx_record_test(&rec);
+    setup(1);
+    ok &= at24cxx_record_test(&rec);
+    setup_array(CHIPS, 1);
+    ok &= at24cxx_array_test(&array);
+    ok &= test_stuck_read();
+    ok &= test_slow_read();
+    ok &= test_poll_then_read();
+    ok &= test_no_ack();
+
+    printf("at24cxx_test: %s\n", ok ? "pass" : "FAIL");
+    return ok;
+}
+
+int main(void)
+{
+    int ok = 1;
+
+    ok &= run_tests();
+
+    printf("at24c16, %u B page, tWR %u us, %u KHz\n", 
+        PAGE_SIZE, 3000, 1000000 / bus.bit_ns);
+    ok &= bench_write();
+    ok &= bench_small_write();
+    ok &= bench_read();
+    printf("array of at24c02, %u B page\n", CHIP_PAGE_SIZE);
+    ok &= bench_array();
+
+    return ok ? 0 : 1;
+}
+
+/****************************** Copy right 2026 *******************************/
@@ -0,0 +1,169 @@
+/**
+  ******************************************************************************
+  * \brief      host-side at24cxx simulator
+  * \file       at24cxx_sim.c
+  * \author     doerthous
+  * \date       2026-10-19
+  * \details    Emulates at24c01/02/04/08/16 on a simulated i2c bus: block 
+  *             select addressing, page write wrap-around, inner address 
+  *             counter, and no address ack during the inner write cycle.
+  ******************************************************************************
+  */
+
+#include <i2c.h>
+#include <string.h>
+
+enum
+{
+    IDLE,
+    DEV_ADDR,
+    WORD_ADDR,
+    WRITE_DATA,
+    READ_DATA,
+};
+
+i2c_t *i2c_sim_clock;
+
+static inline void bus_bits(i2c_t *i2c, uint32_t bits)
+{
+    i2c->now += (uint64_t)bits * i2c->bit_ns;
+}
+
+static inline uint32_t dev_blocks(at24cxx_sim_t *dev)
+{
+    return dev->capacity > 256 ? dev->capacity / 256 : 1;
+}
+
+static void commit(at24cxx_sim_t *dev, uint64_t now)
+{
+    uint32_t base = dev->counter & ~(dev->page_size-1);
+    uint32_t i, n = 0;
+
+    for (i = 0; i < dev->page_size; ++i) {
+        if (dev->latched[i]) {
+            dev->mem[base + i] = dev->latch[i];
+            ++n;
+        }
+    }
+    memset(dev->latched, 0, sizeof(dev->latched));
+
+    if (n > 0) {
+        dev->busy_until = now + dev->twr_us * 1000ull;
+    }
+}
+
+void i2c_start(i2c_t *i2c)
+{
+    i2c_sim_clock = i2c;
+    bus_bits(i2c, 1);
+    ++i2c->starts;
+
+    // a write without stop condition is not programmed
+    if (i2c->state == WRITE_DATA) {
+        memset(i2c->sel->latched, 0, sizeof(i2c->sel->latched));
+    }
+    i2c->sel = 0;
+    i2c->state = DEV_ADDR;
+}
+
+void i2c_stop(i2c_t *i2c)
+{
+    bus_bits(i2c, 1);
+    if (i2c->state == WRITE_DATA) {
+        commit(i2c->sel, i2c->now);
+    }
+    i2c->state = IDLE;
+}
+
+int i2c_7b_addr(i2c_t *i2c, uint8_t addr, int rd)
+{
+    at24cxx_sim_t *dev;
+    uint32_t i;
+
+    bus_bits(i2c, 9);
+    ++i2c->bytes;
+
+    if (i2c->state != DEV_ADDR) {
+        return 0;
+    }
+
+    for (i = 0; i < i2c->count; ++i) {
+        dev = &i2c->devs[i];
+        if ((addr & ~(dev_blocks(dev)-1)) == dev->address) {
+            break;
+        }
+    }
+    if (i == i2c->count || i2c->now < dev->busy_until) {
+        ++i2c->nacks;
+        i2c->state = IDLE;
+        return 0;
+    }
+
+    i2c->sel = dev;
+    if (rd) {
+        i2c->state = READ_DATA;
+    }
+    else {
+        // An address phase alone, as an ack poll, leaves the counter: it
+        // only takes the block select bits with the word address.
+        dev->block = (addr & (dev_blocks(dev)-1)) << 8;
+        i2c->state = WORD_ADDR;
+    }
+
+    return 1;
+}
+
+int i2c_write(i2c_t *i2c, uint8_t data)
+{
+    at24cxx_sim_t *dev = i2c->sel;
+    uint32_t base, offset;
+
+    bus_bits(i2c, 9);
+    ++i2c->bytes;
+
+    switch (i2c->state) {
+    case WORD_ADDR:
+        dev->counter = (dev->block | data) % dev->capacity;
+        i2c->state = WRITE_DATA;
+        return 1;
+    case WRITE_DATA:
+        // only the lower address bits increase: wrap inside the page
+        base = dev->counter & ~(dev->page_size-1);
+        offset = dev->counter & (dev->page_size-1);
+        dev->latch[offset] = data;
+        dev->latched[offset] = 1;
+        dev->counter = base | ((offset + 1) & (dev->page_size-1));
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+uint8_t i2c_read(i2c_t *i2c, int ack)
+{
+    at24cxx_sim_t *dev = i2c->sel;
+    uint8_t data;
+
+    bus_bits(i2c, 9);
+    ++i2c->bytes;
+
+    if (i2c->state != READ_DATA) {
+        return 0xFF;
+    }
+
+    data = dev->mem[dev->counter];
+    dev->counter = (dev->counter + 1) % dev->capacity;
+    if (!ack) {
+        i2c->state = IDLE;
+    }
+
+    return data;
+}
+
+int i2c_busy(i2c_t *i2c)
+{
+    (void)i2c;
+    return 0;
+}
+
+/****************************** Copy right 2026 *******************************/
@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * \brief      host-side i2c_t stand-in
+  * \file       i2c.h
+  * \author     doerthous
+  * \date       2026-10-19
+  * \details    A simulated i2c bus with at24cxx devices attached, to run 
+  *             at24cxx.c on linux. Time is simulated: every bit on the 
+  *             bus and every delay_ms() advance the bus clock.
+  ******************************************************************************
+  */
+
+#ifndef I2C_H_
+#define I2C_H_
+
+#include <stdint.h>
+
+typedef struct at24cxx_sim
+{
+    uint8_t address; // 7-bit, block select bits cleared
+    uint32_t capacity; // Byte
+    uint32_t page_size; // Byte
+    uint32_t twr_us; // inner write cycle
+    uint8_t mem[2048];
+    //
+    uint32_t counter; // inner address counter
+    uint32_t block; // block select bits, loaded with the word address
+    uint64_t busy_until; // ns
+    uint8_t latch[64];
+    uint8_t latched[64];
+} at24cxx_sim_t;
+
+typedef struct i2c
+{
+    at24cxx_sim_t *devs;
+    uint32_t count;
+    uint32_t bit_ns; // 10000: 100KHz
+    // optional, run by delay_ms() as the interrupts would while waiting
+    void (*idle)(struct i2c *i2c);
+    //
+    uint64_t now; // ns
+    at24cxx_sim_t *sel;
+    uint8_t state;
+    // statistics
+    uint32_t starts;
+    uint32_t bytes;
+    uint32_t nacks;
+} i2c_t;
+
+void i2c_start(i2c_t *i2c);
+void i2c_stop(i2c_t *i2c);
+int i2c_7b_addr(i2c_t *i2c, uint8_t addr, int rd); // return ack
+int i2c_write(i2c_t *i2c, uint8_t data); // return ack
+uint8_t i2c_read(i2c_t *i2c, int ack);
+int i2c_busy(i2c_t *i2c);
+
+// the bus clock used by delay_ms()
+extern i2c_t *i2c_sim_clock;
+
+#endif /* I2C_H_ */
+
+/****************************** Copy right 2026 *******************************/
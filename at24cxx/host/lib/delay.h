@@ -0,0 +1,29 @@
+/**
+  ******************************************************************************
+  * \brief      host-side delay stand-in
+  * \file       delay.h
+  * \author     doerthous
+  * \date       2026-10-19
+  * \details    Advance the simulated bus clock instead of sleeping, then 
+  *             let the bus idle hook run.
+  ******************************************************************************
+  */
+
+#ifndef DELAY_H_
+#define DELAY_H_
+
+#include <i2c.h>
+
+static inline void delay_ms(uint32_t ms)
+{
+    if (i2c_sim_clock) {
+        i2c_sim_clock->now += ms * 1000000ull;
+        if (i2c_sim_clock->idle) {
+            i2c_sim_clock->idle(i2c_sim_clock);
+        }
+    }
+}
+
+#endif /* DELAY_H_ */
+
+/****************************** Copy right 2026 *******************************/
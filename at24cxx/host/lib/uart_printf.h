@@ -0,0 +1,19 @@
+/**
+  ******************************************************************************
+  * \brief      host-side uart_printf stand-in
+  * \file       uart_printf.h
+  * \author     doerthous
+  * \date       2026-10-19
+  ******************************************************************************
+  */
+
+#ifndef UART_PRINTF_H_
+#define UART_PRINTF_H_
+
+#include <stdio.h>
+
+#define uart_printf(uart, ...) printf(__VA_ARGS__)
+
+#endif /* UART_PRINTF_H_ */
+
+/****************************** Copy right 2026 *******************************/
@@ -50,3 +50,146 @@ int at24cxx_test(at24cxx_t *at24cxx)
 		
 	return 1;
 }
+
+int at24cxx_array_test(at24cxx_array_t *array)
+{
+	static uint8_t buff[8192];
+	uint8_t *in = buff;
+	uint8_t *out = buff + 4096;
+	uint32_t size, i;
+	
+	
+	if (!at24cxx_array_init(array)) {
+		return 0;
+	}
+	
+	size = array->capacity < 4096 ? array->capacity : 4096;
+	
+	for (i = 0; i < size; i++) {
+		in[i] = rand() % 256;
+	}
+	
+	if (at24cxx_array_write(array, 0, in, size) != size) {
+		return 0;
+	}
+	
+	if (at24cxx_array_read(array, 0, out, size) != size) {
+		return 0;
+	}
+	
+	if (memcmp(in, out, size) != 0) {
+		return 0;
+	}
+	
+	if (at24cxx_array_write(array, 5, in, size-5) != size-5) {
+		return 0;
+	}
+	
+	if (at24cxx_array_read(array, 5, out, size-5) != size-5) {
+		return 0;
+	}
+	
+	if (memcmp(in, out, size-5) != 0) {
+		return 0;
+	}
+	
+	return 1;
+}
+
+int at24cxx_cursor_test(at24cxx_t *at24cxx)
+{
+	static uint8_t in[2048];
+	static uint8_t out[2048];
+	uint32_t i;
+	
+	
+	for (i = 0; i < at24cxx->capacity; i++) {
+		in[i] = rand() % 256;
+	}
+	
+	if (at24cxx_write(at24cxx, 0, in, at24cxx->capacity) != at24cxx->capacity) {
+		return 0;
+	}
+	
+	// record by record, then across the end of memory
+	at24cxx_seek(at24cxx, 0);
+	for (i = 0; i < at24cxx->capacity; i += 16) {
+		if (at24cxx_read_next(at24cxx, out+i, 16) != 16) {
+			return 0;
+		}
+	}
+	if (at24cxx_read_next(at24cxx, out, 16) != 16) {
+		return 0;
+	}
+	
+	return memcmp(in, out, at24cxx->capacity) == 0;
+}
+
+int at24cxx_record_test(at24cxx_record_t *rec)
+{
+	uint8_t in[AT24CXX_RECORD_SLOT_MAX];
+	uint8_t out[AT24CXX_RECORD_SLOT_MAX];
+	uint32_t size = rec->slot_size - 3;
+	uint32_t i, j;
+	
+	
+	if (!at24cxx_record_init(rec)) {
+		return 0;
+	}
+	
+	// more than one turn around the region
+	for (i = 0; i < rec->slot_count * 2 + 1; i++) {
+		for (j = 0; j < size; j++) {
+			in[j] = rand() % 256;
+		}
+		if (at24cxx_record_write(rec, in) != size) {
+			return 0;
+		}
+	}
+	
+	// the newest one is found again from scratch
+	if (!at24cxx_record_init(rec)) {
+		return 0;
+	}
+	
+	if (at24cxx_record_read(rec, out) != size) {
+		return 0;
+	}
+	
+	return memcmp(in, out, size) == 0;
+}
+
+static volatile uint32_t async_size;
+static void async_done(at24cxx_t *at24cxx, uint32_t size)
+{
+	(void)at24cxx;
+	async_size = size;
+}
+
+int at24cxx_async_test(at24cxx_t *at24cxx)
+{
+	static uint8_t in[2048];
+	static uint8_t out[2048];
+	uint32_t i;
+	
+	
+	for (i = 0; i < at24cxx->capacity; i++) {
+		in[i] = rand() % 256;
+	}
+	
+	if (at24cxx_write(at24cxx, 0, in, at24cxx->capacity) != at24cxx->capacity) {
+		return 0;
+	}
+	
+	async_size = 0;
+	if (!at24cxx_read_async(at24cxx, 0, out, at24cxx->capacity, async_done)) {
+		return 0;
+	}
+	while (at24cxx_busy(at24cxx));
+	
+	if (async_size != at24cxx->capacity) {
+		return 0;
+	}
+	
+	return memcmp(in, out, at24cxx->capacity) == 0;
+}
@@ -14,20 +14,283 @@
 #include <gpio.h>
 #include <spi.h>
 
+// Counters, updated on the way: transactions and bytes per frame are 
+// spi_transactions/spi_bytes over rx_frames+tx_frames.
 typedef struct
+{
+    uint32_t spi_transactions; // chip selects
+    uint32_t spi_bytes; // command bytes included
+    uint32_t spi_retries; // failed transfers tried again
+    uint32_t rx_frames;
+    uint32_t rx_dropped; // by rx_classifier or enc28j60_rx_skip
+    uint32_t rx_crc_errors; // receive status vector, counted in rx_frames
+    uint32_t rx_length_errors; // 802.3 length field and data size differ
+    uint32_t rx_overflows; // RXERIF
+    uint32_t flow_events; // link partner held
+    uint32_t tx_frames;
+    uint32_t tx_errors;
+    uint32_t collisions;
+    uint32_t late_collisions; // duplex mismatch
+    uint32_t link_changes;
+    uint32_t rx_poll_entries; // interrupt to polling, see rx_budget
+    uint32_t rx_poll_exits;
+    uint32_t rx_resets; // see enc28j60_rx_recover
+    uint32_t tx_resets;
+} enc28j60_stats_t;
+
+typedef struct
+{
+    uint8_t link:1;
+    uint8_t full_duplex:1;
+    uint32_t collisions;
+    uint32_t late_collisions;
+} enc28j60_link_status_t;
+
+// transmit status vector
+typedef struct
+{
+    uint16_t byte_count;
+    uint16_t wire_count; // collided bytes included
+    uint8_t collisions;
+    #define ENC28J60_TX_DONE                    (1<<0)
+    #define ENC28J60_TX_CRC_ERROR               (1<<1)
+    #define ENC28J60_TX_LEN_ERROR               (1<<2)
+    #define ENC28J60_TX_LEN_OUT_OF_RANGE        (1<<3)
+    #define ENC28J60_TX_EXCESSIVE_COLLISION     (1<<4)
+    #define ENC28J60_TX_LATE_COLLISION          (1<<5)
+    #define ENC28J60_TX_UNDERRUN                (1<<6)
+    #define ENC28J60_TX_ABORTED                 (1<<7) // TXERIF, no vector
+    uint8_t flags;
+} enc28j60_tx_status_t;
+
+#define ENC28J60_TX_SLOT_MAX 4
+#define ENC28J60_TX_SLOT_SIZE 1536 // Byte
+
+typedef struct enc28j60
 {
     gpio_t cs;
     spi_t *spi;
     uint8_t mac_addr[6];
     uint8_t half_mode:1;
+    // The frames sent carry their own FCS, see enc28j60_packet_t.fcs: 
+    // TXCRCEN and the padding are off.
+    uint8_t tx_soft_fcs:1;
+    // Frames sent come back to the receiver inside the PHY, nothing goes
+    // on the wire. Send them to mac_addr (or broadcast) to pass the filter.
+    uint8_t phy_loopback:1;
+    // Buffer memory partition, 0: default, 2 slots and the rest (5KB) for
+    // the receive ring. The ring size must be even, and with tx_slot_count
+    // * ENC28J60_TX_SLOT_SIZE fit in the 8KB. Receive-heavy nodes want a 
+    // large ring, a single slot leaves 6.5KB.
+    uint16_t rx_ring_size; // Byte
+    uint8_t tx_slot_count; // 1 ~ ENC28J60_TX_SLOT_MAX
+    // Flow control, 0: off. Once the receive ring holds rx_watermark bytes
+    // the link partner is held, by pause frames in full duplex or by 
+    // backpressure in half duplex, until it drains below half of that.
+    // Looked at by every receive call, recv, recv_batch, recv_pbuf and the
+    // interrupt drain, so the ring must be polled to release the partner.
+    uint16_t rx_watermark; // Byte
+    // optional, see enc28j60_rx_classifier_t
+    uint32_t (*rx_classifier)(struct enc28j60 *enc28j60, 
+        const uint8_t *header, uint32_t size);
     //
     uint8_t current_bank:2;
+    uint8_t flow_on:1;
+    uint8_t half_duplex:1; // the PHY one, the MAC is set up for it
+    // shadow of the receive buffer pointers
+    uint16_t rx_start;
+    uint16_t rx_end;
+    uint16_t next_pkt;
+    uint8_t rdpt_moved:1; // ERDPT written off the receive path
+    // transmit slots, tx_head is on the wire, the others wait for it
+    uint8_t tx_head;
+    uint8_t tx_count;
+    uint8_t tx_prepared:1; // slot tx_head+tx_count uploaded, not committed
+    uint16_t tx_size[ENC28J60_TX_SLOT_MAX];
+    enc28j60_tx_status_t tx_status; // last completed
+    void (*tx_handler)(struct enc28j60 *enc28j60, 
+        enc28j60_tx_status_t *status);
+    enc28j60_stats_t stats;
+    // last frame received, crc included: above the size returned or passed
+    // to the handler, the frame was truncated
+    uint32_t rx_length;
+    // interrupt driven receive
+    volatile uint8_t irq_pending;
+    uint8_t *rx_buff;
+    uint32_t rx_buff_size;
+    void (*rx_handler)(struct enc28j60 *enc28j60, 
+        uint8_t *data, uint32_t size);
+    uint32_t rx_drained;
+    // Hybrid receive, 0: interrupt only. When an interrupt finds rx_budget
+    // frames or more, PKTIE is turned off and enc28j60_process() polls up 
+    // to rx_budget frames per call, until rx_idle_polls calls in a row find
+    // none: under load the interrupt handling cost is not paid per frame, 
+    // and the budget bounds the time spent per call.
+    uint32_t rx_budget;
+    uint32_t rx_idle_polls;
+    uint8_t rx_polling:1;
+    uint32_t rx_idle;
+    void (*link_handler)(struct enc28j60 *enc28j60, 
+        enc28j60_link_status_t *status);
 } enc28j60_t;
 
 int enc28j60_init(enc28j60_t *enc28j60);
+// Copy the counters, and clear them to measure the next interval.
+void enc28j60_stats(enc28j60_t *enc28j60, enc28j60_stats_t *stats);
+void enc28j60_stats_reset(enc28j60_t *enc28j60);
+// Return once the frame is queued in a transmit slot, waits only while 
+// every slot is busy: a frame that then fails on the wire still returns 1,
+// unlike before the transmit slots. The queue moves on with each send and
+// enc28j60_tx_poll(); enc28j60_tx_wait() waits for it and tells how it went.
 uint32_t enc28j60_send(enc28j60_t *enc28j60, uint8_t *data, uint32_t size);
 uint32_t enc28j60_recv(enc28j60_t *enc28j60, uint8_t *data, uint32_t size);
 
+// Receive classifier: with rx_classifier set, only the receive status 
+// vector and the ethernet header (header[0~5], header[6~19]) are read 
+// first, size is the frame length with crc. Return the bytes to read:
+// ENC28J60_RX_DROP skips the frame without reading it, a value below size 
+// truncates it. Dropped frames are not returned by enc28j60_recv nor 
+// passed to the rx_handler.
+#define ENC28J60_RX_DROP            (0)
+#define ENC28J60_RX_ACCEPT          (0xFFFFFFFF)
+#define ENC28J60_RX_HEADER_SIZE     (6+14)
+typedef uint32_t (*enc28j60_rx_classifier_t)(enc28j60_t *enc28j60, 
+    const uint8_t *header, uint32_t size);
+
+// Zero-copy receive: frames are read straight from the chip into buffers
+// of a fixed-size pool, in one SPI transaction each, and the buffer is 
+// handed over to the caller, who gives it back with enc28j60_pool_free().
+// headroom bytes are left free in front of the frame for the headers of 
+// a reply or an encapsulation. The pool is not locked, use it from one 
+// context only.
+typedef struct enc28j60_pbuf
+{
+    struct enc28j60_pbuf *next; // free list, or caller's use when owned
+    uint8_t *buff; // buff_size bytes
+    uint8_t *data; // frame, buff + headroom
+    uint32_t size; // frame length, crc included
+    uint16_t status; // receive status vector bits 16~31
+} enc28j60_pbuf_t;
+
+typedef struct
+{
+    enc28j60_pbuf_t *pbufs; // count descriptors
+    uint8_t *mem; // count*buff_size bytes
+    uint32_t count;
+    uint32_t buff_size; // Byte
+    uint32_t headroom; // Byte
+    //
+    enc28j60_pbuf_t *free;
+} enc28j60_pool_t;
+
+int enc28j60_pool_init(enc28j60_pool_t *pool);
+enc28j60_pbuf_t *enc28j60_pool_alloc(enc28j60_pool_t *pool);
+void enc28j60_pool_free(enc28j60_pool_t *pool, enc28j60_pbuf_t *pbuf);
+// Return null if there is no frame or no free buffer.
+enc28j60_pbuf_t *enc28j60_recv_pbuf(enc28j60_t *enc28j60, 
+    enc28j60_pool_t *pool);
+
+// Asynchronous transmit: enc28j60_send_async() copies the frame into a
+// free slot and returns at once, 0 if all slots are in use. Completion is
+// picked up by enc28j60_tx_poll() or, with enc28j60_tx_interrupt(), by 
+// enc28j60_process(); the status vector is then in tx_status and handed 
+// to handler.
+typedef void (*enc28j60_tx_handler_t)(enc28j60_t *enc28j60, 
+    enc28j60_tx_status_t *status);
+int enc28j60_send_async(enc28j60_t *enc28j60, uint8_t *data, uint32_t size);
+int enc28j60_tx_poll(enc28j60_t *enc28j60);
+// Wait until every queued frame is sent, return 1 if the last one went out
+// without error, 0 on an error or if the transmit logic is stuck (see 
+// enc28j60_tx_recover).
+int enc28j60_tx_wait(enc28j60_t *enc28j60);
+int enc28j60_tx_interrupt(enc28j60_t *enc28j60, enc28j60_tx_handler_t handler);
+static inline int enc28j60_tx_idle(enc28j60_t *enc28j60)
+{
+    return enc28j60->tx_count == 0;
+}
+
+// Scatter-gather transmit: the segments are uploaded back to back in one
+// SPI transaction, so headers and payload need not be contiguous.
+typedef struct
+{
+    uint8_t *data;
+    uint32_t size;
+} enc28j60_iovec_t;
+int enc28j60_sendv_async(enc28j60_t *enc28j60, 
+    enc28j60_iovec_t *iov, uint32_t count);
+uint32_t enc28j60_sendv(enc28j60_t *enc28j60, 
+    enc28j60_iovec_t *iov, uint32_t count);
+
+// Checksum offload: enc28j60_tx_prepare() uploads a frame without sending
+// it, enc28j60_tx_checksum() lets the on-chip DMA engine compute the 
+// internet checksum of frame bytes [start, start+size) and writes it at 
+// offset, big endian, then enc28j60_tx_commit() queues the frame. The 
+// checksum field must hold 0 beforehand, or for udp/tcp the folded sum of
+// the pseudo header. No other frame can be sent in between.
+int enc28j60_tx_prepare(enc28j60_t *enc28j60, 
+    enc28j60_iovec_t *iov, uint32_t count);
+int enc28j60_tx_checksum(enc28j60_t *enc28j60, 
+    uint16_t start, uint16_t size, uint16_t offset);
+int enc28j60_tx_commit(enc28j60_t *enc28j60);
+// checksum of buffer memory [addr, addr+size), wrapping in the rx buffer
+int enc28j60_dma_checksum(enc28j60_t *enc28j60, 
+    uint16_t addr, uint16_t size, uint16_t *csum);
+
+// Forwarding: enc28j60_rx_peek() reads the first size bytes of the next 
+// received frame and returns its length (crc included) but leaves it 
+// pending. It is then read as usual, dropped by enc28j60_rx_skip(), or 
+// moved by enc28j60_rx_forward() into a transmit slot by the on-chip DMA
+// engine, without crossing SPI; only its first size bytes are replaced by
+// header. The forwarded frame is prepared, see enc28j60_tx_prepare(): 
+// patch a checksum if needed and enc28j60_tx_commit() it. This saves the
+// SPI bytes of the payload, not transactions: the DMA set up is one per 
+// register, and peek, forward and commit take about 40 of them.
+uint32_t enc28j60_rx_peek(enc28j60_t *enc28j60, uint8_t *buff, uint32_t size);
+int enc28j60_rx_skip(enc28j60_t *enc28j60);
+int enc28j60_rx_forward(enc28j60_t *enc28j60, uint8_t *header, uint32_t size);
+
+// Interrupt driven receive: call enc28j60_irq() from the INT pin (falling 
+// edge) interrupt, and enc28j60_process() from the main loop, which costs
+// no SPI access until an interrupt comes, then passes every pending frame
+// to handler. With rx_budget set, call it regularly, not only after an
+// interrupt. A frame larger than size is truncated, rx_length tells.
+typedef void (*enc28j60_rx_handler_t)(enc28j60_t *enc28j60, 
+    uint8_t *data, uint32_t size);
+int enc28j60_rx_interrupt(enc28j60_t *enc28j60, 
+    uint8_t *buff, uint32_t size, enc28j60_rx_handler_t handler);
+uint32_t enc28j60_process(enc28j60_t *enc28j60);
+// Pass the frames pending now to handler, through buff, with one packet 
+// count read and one ERXRDPT update for the whole batch. The handler may
+// send, buff is not used again until it returns.
+uint32_t enc28j60_recv_batch(enc28j60_t *enc28j60, 
+    uint8_t *buff, uint32_t size, enc28j60_rx_handler_t handler);
+static inline void enc28j60_irq(enc28j60_t *enc28j60)
+{
+    enc28j60->irq_pending = 1;
+}
+
+// Error recovery without enc28j60_init: only the receive or transmit 
+// logic is reset, the MAC and PHY configuration and the link stay. 
+// enc28j60_rx_recover() empties the receive ring, the pending frames are 
+// lost, and a link partner held by flow control is let go; it is done by
+// the driver when a frame header read twice is not valid, call it on 
+// ESTAT.BUFER. enc28j60_tx_recover() completes a transmission done but 
+// not polled yet, and only when TXRTS is stuck without TXIF or TXERIF 
+// resets the transmit logic and starts the pending frame again: call it 
+// when a transmission does not seem to complete.
+int enc28j60_rx_recover(enc28j60_t *enc28j60);
+int enc28j60_tx_recover(enc28j60_t *enc28j60);
+
+// Link: the MAC duplex follows the PHY one (half_duplex) since init, 
+// enc28j60_link_status() reads the link state. With enc28j60_link_interrupt()
+// handler is called from enc28j60_process() on link changes.
+typedef void (*enc28j60_link_handler_t)(enc28j60_t *enc28j60, 
+    enc28j60_link_status_t *status);
+int enc28j60_link_status(enc28j60_t *enc28j60, 
+    enc28j60_link_status_t *status);
+int enc28j60_link_interrupt(enc28j60_t *enc28j60, 
+    enc28j60_link_handler_t handler);
+
 #define ENC28J60_REG_EIE            (0x1B)
 # define ENC28J60_REG_EIE_RXERIE        (1<<0)
 # define ENC28J60_REG_EIE_TXERIE        (1<<1)
@@ -100,6 +363,30 @@ static inline int enc28j60_disable_global_interrupt(enc28j60_t *enc28j60)
     enc28j60_enable_global_interrupt(enc28j60); \
 } while (0)
 
+// Receive filters (ERXFCON). In OR mode a frame is accepted if any enabled
+// filter matches, in AND mode if all do; frames with a bad crc are always
+// dropped if CRC is set. 0: accept everything.
+#define ENC28J60_RX_FILTER_BROADCAST    (1<<0)
+#define ENC28J60_RX_FILTER_MULTICAST    (1<<1)
+#define ENC28J60_RX_FILTER_HASH         (1<<2)
+#define ENC28J60_RX_FILTER_MAGIC        (1<<3)
+#define ENC28J60_RX_FILTER_PATTERN      (1<<4)
+#define ENC28J60_RX_FILTER_CRC          (1<<5)
+#define ENC28J60_RX_FILTER_AND          (1<<6)
+#define ENC28J60_RX_FILTER_UNICAST      (1<<7)
+int enc28j60_set_rx_filter(enc28j60_t *enc28j60, uint8_t filter);
+// hash table filter: add the multicast addresses to a zeroed table
+void enc28j60_hash_table_add(uint8_t table[8], const uint8_t mac[6]);
+int enc28j60_set_hash_table(enc28j60_t *enc28j60, const uint8_t table[8]);
+// pattern match filter: the bytes of the 64-byte window at offset selected
+// by mask (bit i for byte i) must equal those of pattern.
+int enc28j60_set_pattern(enc28j60_t *enc28j60, uint16_t offset, 
+    const uint8_t mask[8], const uint8_t pattern[64]);
+
+// Packing in place: reserve ENC28J60_HEADER_SIZE bytes of headroom at 
+// data, let the protocol write its payload at data+ENC28J60_HEADER_SIZE 
+// and point payload there, then enc28j60_pack only fills the header in.
+#define ENC28J60_HEADER_SIZE (14)
 typedef struct
 {
     uint8_t dist_mac_addr[6];
@@ -107,14 +394,20 @@ typedef struct
     uint8_t *payload;
     uint16_t payload_size;
     uint16_t type;
-    uint32_t crc;
+    uint32_t crc; // FCS
+    // pack: append the FCS, for tx_soft_fcs; unpack: verify it
+    uint8_t fcs:1;
     //
     uint8_t *data;
     uint32_t data_size;
 } enc28j60_packet_t;
 
 int enc28j60_pack(enc28j60_packet_t *packet);
+// data_size includes the FCS. With fcs set, return 0 if it does not match.
 int enc28j60_unpack(enc28j60_packet_t *packet);
+// FCS of a frame, table driven: bytewise with a 1KB table, or slice-by-8 
+// with ENC28J60_CRC_SLICE_BY_8 defined, 8KB, see enc28j60_crc_test.
+uint32_t enc28j60_crc32(const uint8_t *data, uint32_t size);
 
 
 #endif /* ENC28J60_H_ */
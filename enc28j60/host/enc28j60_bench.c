@@ -0,0 +1,800 @@
+/**
+  ******************************************************************************
+  * \brief      host-side enc28j60 benchmark
+  * \file       enc28j60_bench.c
+  * \author     doerthous
+  * \date       2026-10-19
+  * \details    Runs enc28j60_test.c on the simulator, then offers the same
+  *             traffic to each receive path of the driver and reports the
+  *             simulated frames/s, spi cost per frame and drop rate. The
+  *             frames received and echoed must be ones offered, intact and
+  *             in order, or the run fails. The traffic is an imix at line
+  *             rate, or read from a pcap file with its timing; the frames
+  *             sent by the echo paths can be written to a pcap file.
+  *             gcc -I. -Ienc28j60/host [-DENC28J60_CRC_SLICE_BY_8]
+  *                 enc28j60.c enc28j60_test.c
+  *                 enc28j60/host/enc28j60_sim.c enc28j60/host/enc28j60_bench.c
+  *             ./a.out [in.pcap|- [out.pcap]], -: imix
+  ******************************************************************************
+  */
+
+#include "enc28j60.h"
+#include <enc28j60_sim.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+int enc28j60_test(enc28j60_t *enc28j60);
+int enc28j60_rx_cost_test(enc28j60_t *enc28j60, uint32_t frames);
+int enc28j60_rx_batch_cost_test(enc28j60_t *enc28j60, uint32_t frames);
+int enc28j60_stats_test(enc28j60_t *enc28j60, uint32_t frames);
+int enc28j60_crc_test(uint32_t (*clock_us)(void));
+int enc28j60_loopback_test(enc28j60_t *enc28j60, uint32_t (*clock_us)(void),
+    uint32_t frames);
+int enc28j60_recover_test(enc28j60_t *enc28j60, uint32_t (*clock_us)(void));
+int enc28j60_rx_interrupt_test(enc28j60_t *enc28j60);
+int enc28j60_tx_wait_test(enc28j60_t *enc28j60);
+int enc28j60_filter_test(enc28j60_t *enc28j60);
+int enc28j60_classifier_test(enc28j60_t *enc28j60);
+int enc28j60_pack_test(enc28j60_t *enc28j60);
+int enc28j60_checksum_test(enc28j60_t *enc28j60);
+int enc28j60_forward_test(enc28j60_t *enc28j60);
+int enc28j60_rx_error_test(enc28j60_t *enc28j60);
+int enc28j60_burst_test(enc28j60_t *enc28j60, uint32_t burst, uint32_t delay);
+int enc28j60_hybrid_test(enc28j60_t *enc28j60, uint32_t frames, 
+    uint32_t budget);
+
+
+//#
+#define FRAMES_MAX  2000
+#define POOL_SIZE   8
+
+typedef struct
+{
+    uint64_t at; // ns, from the first frame
+    uint32_t size; // without fcs
+    uint8_t data[1514];
+} traffic_t;
+
+static enc28j60_sim_t sim;
+static spi_t spi = { .sim = &sim };
+static enc28j60_t enc;
+static const uint8_t mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+static traffic_t traffic[FRAMES_MAX];
+static uint32_t traffic_count;
+static uint8_t rx_filter = ENC28J60_RX_FILTER_UNICAST
+    | ENC28J60_RX_FILTER_CRC | ENC28J60_RX_FILTER_BROADCAST;
+static FILE *pcap_out;
+static uint64_t pcap_base; // ns, simulated time of the runs before
+
+static uint8_t buff[1518];
+static uint32_t rx_frames;
+static uint64_t rx_last; // ns
+// frames received or sent back that match no frame offered, see match()
+static uint32_t corrupt;
+static uint32_t rx_next;
+static uint32_t tx_next;
+static int tx_check;
+
+static enc28j60_pbuf_t pbufs[POOL_SIZE];
+static uint8_t pool_mem[POOL_SIZE*1536];
+static enc28j60_pool_t pool = {
+    .pbufs = pbufs, .mem = pool_mem, .count = POOL_SIZE, .buff_size = 1536,
+};
+
+// the crc is cpu time, the simulated clock does not see it
+static uint32_t host_clock_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// The frames come in order, some lost: look for the offered frame from 
+// *next on, the addresses excluded unless from is 0. The frame may carry
+// its fcs and padding.
+static void match(const uint8_t *frame, uint32_t size, uint32_t from,
+    uint32_t *next)
+{
+    for (uint32_t i = *next; i < traffic_count; ++i) {
+        if (size >= traffic[i].size && size <= traffic[i].size + 4 + 60
+            && memcmp(frame + from, traffic[i].data + from, 
+                traffic[i].size - from) == 0) {
+            *next = i + 1;
+            return;
+        }
+    }
+    ++corrupt;
+}
+
+static void tx_sink(enc28j60_sim_t *sim, const uint8_t *frame, uint32_t size)
+{
+    if (tx_check) {
+        match(frame, size, 12, &tx_next);
+    }
+    if (pcap_out) {
+        pcap_write(pcap_out, pcap_base + sim->now, frame, size);
+    }
+}
+
+static void setup(void)
+{
+    memset(&enc, 0, sizeof(enc));
+    enc.cs.sim = &sim;
+    enc.spi = &spi;
+    memcpy(enc.mac_addr, mac, 6);
+
+    sim.tx_sink = tx_sink;
+    pcap_base += sim.now;
+    enc28j60_sim_init(&sim);
+    enc28j60_init(&enc);
+    enc28j60_set_rx_filter(&enc, rx_filter);
+
+    rx_frames = 0;
+    rx_last = 0;
+    corrupt = 0;
+    rx_next = 0;
+    tx_next = 0;
+    tx_check = 0;
+}
+
+// imix: 7 x 64, 4 x 576, 1 x 1514 bytes, back to back, 1 in 8 broadcast
+static void traffic_imix(uint32_t count)
+{
+    static const uint16_t sizes[12] = {
+        60, 60, 576, 60, 60, 576, 60, 1510, 60, 576, 60, 576
+    };
+    uint64_t at = 0;
+    uint32_t i, j;
+
+    for (i = 0; i < count && i < FRAMES_MAX; ++i) {
+        traffic[i].at = at;
+        traffic[i].size = sizes[i % 12];
+        memcpy(traffic[i].data, (i % 8 == 7) ?
+            (const uint8_t *)"\xFF\xFF\xFF\xFF\xFF\xFF" : mac, 6);
+        memcpy(traffic[i].data + 6, "\x02\x00\x00\x00\x00\x02", 6);
+        traffic[i].data[12] = 0x88; // local experimental ethertype
+        traffic[i].data[13] = 0xB5;
+        for (j = 14; j < traffic[i].size; ++j) {
+            traffic[i].data[j] = i + j;
+        }
+        // preamble, fcs and inter packet gap at 10Mbps
+        at += (8 + traffic[i].size + 4 + 12) * 800ull;
+    }
+    traffic_count = i;
+}
+
+static int traffic_pcap(const char *path)
+{
+    FILE *fp = pcap_open_read(path);
+    uint64_t ts, first = 0;
+    uint32_t size;
+
+    if (!fp) {
+        return 0;
+    }
+    for (traffic_count = 0; traffic_count < FRAMES_MAX; ++traffic_count) {
+        traffic_t *t = &traffic[traffic_count];
+        size = pcap_read(fp, &ts, t->data, sizeof(t->data));
+        if (size == 0) {
+            break;
+        }
+        first = traffic_count ? first : ts;
+        t->at = ts - first;
+        t->size = size;
+    }
+    fclose(fp);
+
+    // whatever the addresses, as a capture would do
+    rx_filter = 0;
+
+    return traffic_count > 0;
+}
+
+static uint64_t offer(void)
+{
+    uint64_t base = sim.now + 1000000;
+
+    for (uint32_t i = 0; i < traffic_count; ++i) {
+        enc28j60_sim_schedule_rx(&sim, base + traffic[i].at,
+            traffic[i].data, traffic[i].size);
+    }
+
+    return base;
+}
+
+static void received(const uint8_t *data, uint32_t size)
+{
+    ++rx_frames;
+    rx_last = sim.now;
+    if (data) {
+        match(data, size, 0, &rx_next);
+    }
+}
+
+// Return 0 if a frame did not come out as offered.
+static int run(const char *name, uint32_t (*pass)(void))
+{
+    uint64_t start, end;
+    uint32_t bytes, transactions;
+    double sec;
+
+    start = offer();
+    bytes = sim.spi_bytes;
+    transactions = sim.spi_transactions;
+
+    // the main loop spins every 10us when there is nothing to do
+    end = start + traffic[traffic_count-1].at + 10000000;
+    while (enc28j60_sim_pending(&sim) || sim.now < end) {
+        if (pass() == 0) {
+            enc28j60_sim_advance(&sim, 10000);
+        }
+    }
+
+    bytes = sim.spi_bytes - bytes;
+    transactions = sim.spi_transactions - transactions;
+    sec = rx_last > start ? (rx_last - start) / 1e9 : 0;
+    printf("%-24s %5u/%5u frames %8.0f frames/s %7.1f spi bytes/frame "
+        "%5.2f transactions/frame %5.1f%% dropped%s\n", name,
+        rx_frames, traffic_count, sec > 0 ? rx_frames / sec : 0,
+        rx_frames ? (double)bytes / rx_frames : 0,
+        rx_frames ? (double)transactions / rx_frames : 0,
+        100.0 * (traffic_count - rx_frames) / traffic_count,
+        corrupt ? ", CORRUPT" : "");
+
+    return corrupt == 0;
+}
+
+
+//#
+static uint32_t pass_recv(void)
+{
+    uint32_t size = enc28j60_recv(&enc, buff, sizeof(buff));
+
+    if (size > 0) {
+        received(buff, size);
+        return 1;
+    }
+    return 0;
+}
+
+static void batch_handler(enc28j60_t *enc28j60, uint8_t *data, uint32_t size)
+{
+    (void)enc28j60;
+    received(data, size);
+}
+
+static uint32_t pass_batch(void)
+{
+    return enc28j60_recv_batch(&enc, buff, sizeof(buff), batch_handler);
+}
+
+static uint32_t pass_pbuf(void)
+{
+    enc28j60_pbuf_t *pbuf = enc28j60_recv_pbuf(&enc, &pool);
+
+    if (pbuf) {
+        received(pbuf->data, pbuf->size);
+        enc28j60_pool_free(&pool, pbuf);
+        return 1;
+    }
+    return 0;
+}
+
+// INT pin, falling edge
+static uint32_t pass_process(void)
+{
+    static int asserted;
+    int level = enc28j60_sim_int(&sim);
+    uint32_t n;
+
+    if (level && !asserted) {
+        enc28j60_irq(&enc);
+    }
+    asserted = level;
+
+    n = enc28j60_process(&enc);
+    // enc28j60_isr toggles INTIE, a pending event gives a new edge
+    asserted = 0;
+
+    return n;
+}
+
+// back to the sender
+static uint32_t pass_echo(void)
+{
+    uint32_t size = enc28j60_recv(&enc, buff, sizeof(buff));
+
+    if (size < 18) {
+        return 0;
+    }
+    received(buff, size);
+    memcpy(buff, buff + 6, 6);
+    memcpy(buff + 6, mac, 6);
+    enc28j60_send(&enc, buff, size - 4);
+
+    return 1;
+}
+
+// back to the sender from within the handler: the send moves the read 
+// pointer under the batch
+static void echo_handler(enc28j60_t *enc28j60, uint8_t *data, uint32_t size)
+{
+    if (size < 18) {
+        return;
+    }
+    received(data, size);
+    memcpy(data, data + 6, 6);
+    memcpy(data + 6, mac, 6);
+    enc28j60_send(enc28j60, data, size - 4);
+}
+
+static uint32_t pass_echo_batch(void)
+{
+    return enc28j60_recv_batch(&enc, buff, sizeof(buff), echo_handler);
+}
+
+// back to the sender, the payload does not cross SPI
+static uint32_t pass_forward(void)
+{
+    uint8_t header[12];
+
+    // all slots in use, the frames wait in the ring
+    if (enc.tx_count == enc.tx_slot_count && !enc28j60_tx_poll(&enc)) {
+        return 0;
+    }
+    if (enc28j60_rx_peek(&enc, header, 12) == 0) {
+        return 0;
+    }
+    memcpy(header, header + 6, 6);
+    memcpy(header + 6, mac, 6);
+    if (!enc28j60_rx_forward(&enc, header, 12)) {
+        return 0;
+    }
+    enc28j60_tx_commit(&enc);
+    received(0, 0);
+
+    return 1;
+}
+
+static int bench(void)
+{
+    int ok = 1;
+
+    setup();
+    ok &= run("recv", pass_recv);
+
+    setup();
+    ok &= run("recv_batch", pass_batch);
+
+    setup();
+    enc28j60_pool_init(&pool);
+    ok &= run("recv_pbuf", pass_pbuf);
+
+    setup();
+    enc28j60_rx_interrupt(&enc, buff, sizeof(buff), batch_handler);
+    ok &= run("interrupt", pass_process);
+
+    setup();
+    enc.rx_budget = 8;
+    enc.rx_idle_polls = 4;
+    enc28j60_rx_interrupt(&enc, buff, sizeof(buff), batch_handler);
+    ok &= run("interrupt, budget 8", pass_process);
+
+    setup();
+    enc.rx_watermark = 3072;
+    enc28j60_init(&enc);
+    enc28j60_set_rx_filter(&enc, rx_filter);
+    ok &= run("recv, flow control", pass_recv);
+
+    setup();
+    enc.rx_watermark = 3072;
+    enc28j60_init(&enc);
+    enc28j60_set_rx_filter(&enc, rx_filter);
+    ok &= run("recv_batch, flow control", pass_batch);
+
+    setup();
+    enc.rx_watermark = 3072;
+    enc28j60_init(&enc);
+    enc28j60_set_rx_filter(&enc, rx_filter);
+    enc28j60_rx_interrupt(&enc, buff, sizeof(buff), batch_handler);
+    ok &= run("interrupt, flow control", pass_process);
+
+    setup();
+    tx_check = 1;
+    ok &= run("echo, recv/send", pass_echo);
+
+    setup();
+    tx_check = 1;
+    ok &= run("echo, recv_batch", pass_echo_batch);
+    ok &= enc.stats.rx_resets == 0;
+
+    setup();
+    tx_check = 1;
+    enc28j60_rx_interrupt(&enc, buff, sizeof(buff), echo_handler);
+    ok &= run("echo, interrupt", pass_process);
+    ok &= enc.stats.rx_resets == 0;
+
+    setup();
+    tx_check = 1;
+    ok &= run("echo, rx_forward", pass_forward);
+
+    return ok;
+}
+
+//# fault injection
+static uint32_t accept_all(enc28j60_t *enc28j60, 
+    const uint8_t *header, uint32_t size)
+{
+    (void)enc28j60;
+    (void)header;
+    (void)size;
+    return ENC28J60_RX_ACCEPT;
+}
+
+// A frame to ourselves, the payload depends on seed.
+static void loopback_frame(uint8_t *frame, uint32_t size, uint8_t seed)
+{
+    memcpy(frame, mac, 6);
+    memcpy(frame + 6, mac, 6);
+    frame[12] = 0x88;
+    frame[13] = 0xB5;
+    for (uint32_t i = 14; i < size; ++i) {
+        frame[i] = seed + i * 7;
+    }
+}
+
+// A frame sent to ourselves in PHY loopback.
+static void loopback_send(uint8_t *frame, uint32_t size, uint8_t seed)
+{
+    loopback_frame(frame, size, seed);
+    enc28j60_send(&enc, frame, size);
+    enc28j60_tx_wait(&enc);
+}
+
+static void loopback_setup(void)
+{
+    setup();
+    enc.phy_loopback = 1;
+    enc28j60_init(&enc);
+    enc28j60_pool_init(&pool);
+}
+
+static uint32_t batch_size;
+static void size_handler(enc28j60_t *enc28j60, uint8_t *data, uint32_t size)
+{
+    (void)enc28j60;
+    (void)data;
+    batch_size = size;
+}
+
+// One frame into buff through recv (path 0), recv_batch (1), recv_pbuf (2)
+// or rx_peek and rx_skip (3): its size, 0 if none.
+static uint32_t receive(int path)
+{
+    enc28j60_pbuf_t *pbuf;
+    uint32_t size = 0;
+
+    switch (path) {
+    case 0:
+        return enc28j60_recv(&enc, buff, sizeof(buff));
+    case 1:
+        batch_size = 0;
+        enc28j60_recv_batch(&enc, buff, sizeof(buff), size_handler);
+        return batch_size;
+    case 2:
+        if ((pbuf = enc28j60_recv_pbuf(&enc, &pool))) {
+            size = pbuf->size;
+            memcpy(buff, pbuf->data, size);
+            enc28j60_pool_free(&pool, pbuf);
+        }
+        return size;
+    default:
+        if ((size = enc28j60_rx_peek(&enc, buff, sizeof(buff))) > 0) {
+            enc28j60_rx_skip(&enc);
+        }
+        return size;
+    }
+}
+
+// A header read garbled once on the bus is read again: the frame comes out
+// intact and the ring is not reset, on every receive path.
+static int test_rx_glitch(void)
+{
+    static uint8_t frame[200];
+    int ok = 1;
+
+    for (int path = 0; path < 4 && ok; ++path) {
+        loopback_setup();
+        loopback_send(frame, sizeof(frame), path);
+        sim.read_fault = 6;
+        sim.read_flip = 1;
+        ok = receive(path) == sizeof(frame) + 4
+            && memcmp(buff, frame, sizeof(frame)) == 0
+            && enc.stats.rx_resets == 0 && sim.read_fault == 0;
+    }
+
+    enc.phy_loopback = 0;
+    return ok;
+}
+
+// A next packet pointer corrupted in the ring: the pending frames are lost
+// to a receive reset, the frames after it arrive intact.
+static int test_rx_corrupt(void)
+{
+    static uint8_t frame[200];
+    int ok = 1;
+
+    for (int path = 0; path < 4 && ok; ++path) {
+        loopback_setup();
+        loopback_send(frame, sizeof(frame), path);
+        loopback_send(frame, sizeof(frame), path + 1);
+        sim.mem[enc.next_pkt] |= 1;
+        ok = receive(path) == 0 && enc.stats.rx_resets == 1
+            && receive(path) == 0;
+
+        loopback_send(frame, sizeof(frame), path + 2);
+        ok = ok && receive(path) == sizeof(frame) + 4
+            && memcmp(buff, frame, sizeof(frame)) == 0;
+    }
+
+    enc.phy_loopback = 0;
+    return ok;
+}
+
+// The ring flooded with flow control on: the overflow is counted, and the 
+// receive reset empties the ring and lets the link partner go.
+static int test_rx_overflow(void)
+{
+    static uint8_t frame[1000];
+    int ok;
+
+    setup();
+    enc.phy_loopback = 1;
+    enc.rx_watermark = 3072;
+    enc28j60_init(&enc);
+
+    for (int i = 0; i < 16; ++i) {
+        loopback_send(frame, sizeof(frame), i);
+    }
+    ok = receive(0) == sizeof(frame) + 4 && enc.stats.rx_overflows == 1
+        && enc.flow_on
+        && enc28j60_rx_recover(&enc) && !enc.flow_on
+        && (sim.regs[3][0x17] & 0x03) == 0 && receive(0) == 0;
+
+    loopback_send(frame, sizeof(frame), 16);
+    ok = ok && receive(0) == sizeof(frame) + 4
+        && memcmp(buff, frame, sizeof(frame)) == 0;
+
+    enc.phy_loopback = 0;
+    enc.rx_watermark = 0;
+    return ok;
+}
+
+// A transmission that never completes: enc28j60_tx_recover() resets the 
+// transmit logic and the frame goes out again, intact. One that completed
+// but was not polled yet is only reported, it does not go out twice.
+static int test_tx_stuck(void)
+{
+    static uint8_t frame[200];
+    int ok;
+
+    loopback_setup();
+    loopback_frame(frame, sizeof(frame), 1);
+    sim.tx_stuck = 1;
+    ok = enc28j60_send(&enc, frame, sizeof(frame));
+    enc28j60_sim_advance(&sim, 10000000);
+    ok = ok && enc.tx_count == 1 && receive(0) == 0
+        && enc28j60_tx_recover(&enc) && enc.stats.tx_resets == 1
+        && enc28j60_tx_wait(&enc)
+        && receive(0) == sizeof(frame) + 4
+        && memcmp(buff, frame, sizeof(frame)) == 0;
+
+    loopback_frame(frame, sizeof(frame), 2);
+    ok = ok && enc28j60_send(&enc, frame, sizeof(frame));
+    enc28j60_sim_advance(&sim, 10000000);
+    ok = ok && enc28j60_tx_recover(&enc) && enc.tx_count == 0
+        && enc.stats.tx_resets == 1 && enc.stats.tx_frames == 2
+        && receive(0) == sizeof(frame) + 4
+        && memcmp(buff, frame, sizeof(frame)) == 0
+        && receive(0) == 0;
+
+    enc.phy_loopback = 0;
+    return ok;
+}
+
+// A DMA that never ends: the forward fails instead of spinning, the DMA
+// is stopped, and the frame, still pending, is forwarded on the next try.
+static int test_dma_stuck(void)
+{
+    static uint8_t frame[200];
+    uint8_t header[12];
+    int ok;
+
+    loopback_setup();
+    loopback_send(frame, sizeof(frame), 1);
+    sim.dma_stuck = 1;
+    memcpy(header, frame, 12);
+    ok = enc28j60_rx_forward(&enc, header, 12) == 0
+        && !sim.dma_stuck && !enc.tx_prepared
+        && enc28j60_rx_forward(&enc, header, 12)
+        && enc28j60_tx_commit(&enc) && enc28j60_tx_wait(&enc)
+        && receive(0) == sizeof(frame) + 4
+        && memcmp(buff, frame, sizeof(frame)) == 0
+        && receive(0) == 0;
+
+    enc.phy_loopback = 0;
+    return ok;
+}
+
+// With the classifier, a payload read that fails is tried again from the
+// header: the frame must come out intact.
+static int test_rx_retry(void)
+{
+    static uint8_t frame[200];
+    int ok;
+
+    setup();
+    enc.phy_loopback = 1;
+    enc.rx_classifier = accept_all;
+    enc28j60_init(&enc);
+
+    loopback_send(frame, sizeof(frame), 1);
+    sim.read_fault = sizeof(frame) + 4 - 14;
+    ok = enc28j60_recv(&enc, buff, sizeof(buff)) == sizeof(frame) + 4
+        && memcmp(buff, frame, sizeof(frame)) == 0
+        && enc.stats.spi_retries > 0;
+
+    enc.phy_loopback = 0;
+    enc.rx_classifier = 0;
+    return ok;
+}
+
+// A send that cannot upload returns 0 instead of spinning: here a frame
+// is prepared and never committed.
+static int test_send_fails(void)
+{
+    static uint8_t frame[60];
+    int ok;
+
+    setup();
+    enc.tx_prepared = 1;
+    ok = enc28j60_send(&enc, frame, sizeof(frame)) == 0;
+    enc.tx_prepared = 0;
+
+    return ok;
+}
+
+// A send returns as soon as its frame is queued: with a slot free, a short
+// frame does not wait for the long one before it on the wire. Both arrive.
+static int test_send_queues(void)
+{
+    static const uint16_t sizes[2] = { 1500, 60 };
+    static uint8_t frame[2][1500];
+    int ok = 1;
+
+    loopback_setup();
+    for (int i = 0; i < 2; ++i) {
+        loopback_frame(frame[i], sizes[i], i);
+        ok &= enc28j60_send(&enc, frame[i], sizes[i]);
+    }
+    ok &= enc.tx_count == 2 && enc28j60_tx_wait(&enc);
+    for (int i = 0; i < 2; ++i) {
+        ok &= receive(0) == sizes[i] + 4U
+            && memcmp(buff, frame[i], sizes[i]) == 0;
+    }
+
+    enc.phy_loopback = 0;
+    return ok;
+}
+
+// the INT pin interrupt, taken while the tests wait
+static void int_idle(enc28j60_sim_t *sim)
+{
+    if (enc28j60_sim_int(sim)) {
+        enc28j60_irq(&enc);
+    }
+}
+
+// The tests that need a peer: with none they fail instead of waiting
+// forever, with bursts 500ms apart, one per partition, they pass.
+static int test_peer(void)
+{
+    int ok;
+
+    setup();
+    sim.idle = int_idle;
+    ok = !enc28j60_burst_test(&enc, 50, 10) 
+        && !enc28j60_hybrid_test(&enc, 50, 8);
+
+    traffic_imix(50);
+    for (int b = 0; b < 4; ++b) {
+        for (uint32_t i = 0; i < traffic_count; ++i) {
+            enc28j60_sim_schedule_rx(&sim, sim.now + b * 500000000ull 
+                + traffic[i].at, traffic[i].data, traffic[i].size);
+        }
+    }
+    ok = ok && enc28j60_burst_test(&enc, 50, 10);
+
+    offer();
+    ok = ok && enc28j60_hybrid_test(&enc, 40, 8)
+        && enc.stats.rx_poll_entries > 0;
+
+    sim.idle = 0;
+    return ok;
+}
+
+static int run_tests(void)
+{
+    int ok = 1;
+
+    setup();
+    ok &= enc28j60_test(&enc);
+    ok &= enc28j60_crc_test(host_clock_us);
+    ok &= enc28j60_loopback_test(&enc, enc28j60_sim_clock_us, 20);
+    ok &= enc28j60_recover_test(&enc, enc28j60_sim_clock_us);
+    ok &= enc28j60_rx_interrupt_test(&enc);
+    ok &= enc28j60_tx_wait_test(&enc);
+    // loopback runs in full duplex, the duplex asked for is kept
+    enc.half_mode = 1;
+    ok &= enc28j60_tx_wait_test(&enc) && enc.half_mode && enc.half_duplex;
+    enc.half_mode = 0;
+    ok &= enc28j60_filter_test(&enc);
+    ok &= enc28j60_classifier_test(&enc);
+    ok &= enc28j60_pack_test(&enc);
+    ok &= enc28j60_checksum_test(&enc);
+    ok &= enc28j60_forward_test(&enc);
+    ok &= enc28j60_rx_error_test(&enc);
+    ok &= test_rx_retry();
+    ok &= test_send_fails();
+    ok &= test_send_queues();
+    ok &= test_rx_glitch();
+    ok &= test_rx_corrupt();
+    ok &= test_rx_overflow();
+    ok &= test_tx_stuck();
+    ok &= test_dma_stuck();
+    ok &= test_peer();
+
+    setup();
+    traffic_imix(200);
+    offer();
+    ok &= enc28j60_rx_cost_test(&enc, 50);
+    ok &= enc28j60_rx_batch_cost_test(&enc, 50);
+    ok &= enc28j60_stats_test(&enc, 50);
+
+    printf("enc28j60_test: %s\n", ok ? "pass" : "FAIL");
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    int ok = 1;
+
+    ok &= run_tests();
+
+    if (argc <= 1 || strcmp(argv[1], "-") == 0) {
+        traffic_imix(FRAMES_MAX);
+    }
+    else if (!traffic_pcap(argv[1])) {
+        printf("%s: not a pcap file\n", argv[1]);
+        return 1;
+    }
+    if (argc > 2 && !(pcap_out = pcap_open_write(argv[2]))) {
+        printf("%s: cannot write\n", argv[2]);
+        return 1;
+    }
+
+    printf("%u frames, %uMHz spi\n", traffic_count, 8000 / sim.spi_byte_ns);
+    ok &= bench();
+
+    if (pcap_out) {
+        fclose(pcap_out);
+    }
+
+    return ok ? 0 : 1;
+}
+
+/****************************** Copy right 2026 *******************************/
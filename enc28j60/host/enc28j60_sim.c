@@ -0,0 +1,976 @@
+/**
+  ******************************************************************************
+  * \brief      host-side enc28j60 simulator
+  * \file       enc28j60_sim.c
+  * \author     doerthous
+  * \date       2026-10-19
+  * \details    See enc28j60_sim.h. Follows DS39662 and its silicon errata
+  *             as far as the driver can observe them: RBM wraps at ERXND,
+  *             the ring never writes at ERXRDPT, EPKTCNT saturates at 255,
+  *             PKTIF follows EPKTCNT.
+  ******************************************************************************
+  */
+
+#include "enc28j60_sim.h"
+#include <spi.h>
+#include <gpio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define bit(i) (1<<(i))
+
+#define R(bank, addr)   (((bank)<<5)|(addr))
+// bank 0
+#define ERDPTL          R(0, 0x00)
+#define EWRPTL          R(0, 0x02)
+#define ETXSTL          R(0, 0x04)
+#define ETXNDL          R(0, 0x06)
+#define ERXSTL          R(0, 0x08)
+#define ERXSTH          R(0, 0x09)
+#define ERXNDL          R(0, 0x0A)
+#define ERXRDPTL        R(0, 0x0C)
+#define ERXWRPTL        R(0, 0x0E)
+#define EDMASTL         R(0, 0x10)
+#define EDMANDL         R(0, 0x12)
+#define EDMADSTL        R(0, 0x14)
+#define EDMACSL         R(0, 0x16)
+#define EDMACSH         R(0, 0x17)
+// bank 1
+#define EHT0            R(1, 0x00)
+#define EPMM0           R(1, 0x08)
+#define EPMCSL          R(1, 0x10)
+#define EPMOL           R(1, 0x14)
+#define ERXFCON         R(1, 0x18)
+#define EPKTCNT         R(1, 0x19)
+// bank 2
+#define MACON1          R(2, 0x00)
+#define MACON3          R(2, 0x02)
+#define MAMXFLL         R(2, 0x0A)
+#define MICMD           R(2, 0x12)
+#define MIREGADR        R(2, 0x14)
+#define MIWRL           R(2, 0x16)
+#define MIWRH           R(2, 0x17)
+#define MIRDL           R(2, 0x18)
+#define MIRDH           R(2, 0x19)
+// bank 3
+#define MAADR5          R(3, 0x00)
+#define MAADR6          R(3, 0x01)
+#define MAADR3          R(3, 0x02)
+#define MAADR4          R(3, 0x03)
+#define MAADR1          R(3, 0x04)
+#define MAADR2          R(3, 0x05)
+#define MISTAT          R(3, 0x0A)
+#define EREVID          R(3, 0x12)
+#define EFLOCON         R(3, 0x17)
+#define EPAUSL          R(3, 0x18)
+#define MACLCON1        R(2, 0x08)
+#define MACLCON2        R(2, 0x09)
+// common
+#define EIE             (0x1B)
+# define INTIE          bit(7)
+#define EIR             (0x1C)
+# define RXERIF         bit(0)
+# define TXERIF         bit(1)
+# define TXIF           bit(3)
+# define LINKIF         bit(4)
+# define DMAIF          bit(5)
+# define PKTIF          bit(6)
+#define ESTAT           (0x1D)
+# define CLKRDY         bit(0)
+# define INT            bit(7)
+#define ECON2           (0x1E)
+# define PKTDEC         bit(6)
+# define AUTOINC        bit(7)
+#define ECON1           (0x1F)
+# define RXEN           bit(2)
+# define TXRTS          bit(3)
+# define CSUMEN         bit(4)
+# define DMAST          bit(5)
+# define RXRST          bit(6)
+# define TXRST          bit(7)
+
+// phy
+#define PHCON1          (0x00)
+# define PDPXMD         bit(8)
+# define PLOOPBK        bit(14)
+# define PRST           bit(15)
+#define PHSTAT1         (0x01)
+#define PHID1           (0x02)
+#define PHID2           (0x03)
+#define PHCON2          (0x10)
+# define FRCLNK         bit(14)
+#define PHSTAT2         (0x11)
+# define DPXSTAT        bit(9)
+# define LSTAT          bit(10)
+#define PHIE            (0x12)
+# define PGEIE          bit(1)
+# define PLNKIE         bit(4)
+#define PHIR            (0x13)
+# define PGIF           bit(2)
+# define PLNKIF         bit(4)
+#define PHLCON          (0x14)
+
+// MACON3
+#define FULDPX          bit(0)
+#define TXCRCEN         bit(4)
+
+enum
+{
+    OP_RCR,
+    OP_RBM,
+    OP_WCR,
+    OP_WBM,
+    OP_BFS,
+    OP_BFC,
+    OP_SRC = 7,
+};
+
+static void tick(enc28j60_sim_t *sim);
+
+
+//# registers
+static uint8_t *reg(enc28j60_sim_t *sim, uint8_t id)
+{
+    uint8_t addr = id & 0x1F;
+    if (addr >= 0x1B) {
+        return &sim->regs[0][addr];
+    }
+    return &sim->regs[id>>5][addr];
+}
+
+static inline uint16_t get16(enc28j60_sim_t *sim, uint8_t id)
+{
+    return (*reg(sim, id) | (*reg(sim, id+1) << 8)) & 0x1FFF;
+}
+
+static inline void set16(enc28j60_sim_t *sim, uint8_t id, uint16_t v)
+{
+    *reg(sim, id) = v & 0xFF;
+    *reg(sim, id+1) = (v >> 8) & 0x1F;
+}
+
+static inline int is_mac_mii(uint8_t id)
+{
+    uint8_t bank = id >> 5, addr = id & 0x1F;
+    if (addr >= 0x1B) {
+        return 0;
+    }
+    return bank == 2 || (bank == 3 && (addr <= 0x05 || addr == 0x0A));
+}
+
+static void phy_reset(enc28j60_sim_t *sim)
+{
+    memset(sim->phy, 0, sizeof(sim->phy));
+    sim->phy[PHSTAT1] = 0x1800;
+    sim->phy[PHID1] = 0x0083;
+    sim->phy[PHID2] = 0x1400;
+    sim->phy[PHLCON] = 0x3422;
+}
+
+static void reset(enc28j60_sim_t *sim)
+{
+    memset(sim->regs, 0, sizeof(sim->regs));
+    set16(sim, ERDPTL, 0x05FA);
+    set16(sim, ERXSTL, 0x05FA);
+    set16(sim, ERXNDL, 0x1FFF);
+    set16(sim, ERXRDPTL, 0x05FA);
+    *reg(sim, ERXFCON) = 0xA1;
+    *reg(sim, ESTAT) = CLKRDY;
+    *reg(sim, ECON2) = AUTOINC;
+    set16(sim, MAMXFLL, 0x0600);
+    *reg(sim, MACLCON1) = 0x0F;
+    *reg(sim, MACLCON2) = 0x37;
+    *reg(sim, EREVID) = 0x06;
+    *reg(sim, EPAUSL) = 0x00;
+    *reg(sim, EPAUSL+1) = 0x10;
+    phy_reset(sim);
+    sim->tx_active = 0;
+    sim->paused_until = 0;
+    sim->rx_wire_free = 0;
+}
+
+static uint16_t phy_read(enc28j60_sim_t *sim, uint8_t addr)
+{
+    uint16_t v = sim->phy[addr & 0x1F];
+
+    switch (addr) {
+    case PHSTAT2:
+        v = ((sim->link || (sim->phy[PHCON2] & FRCLNK)) ? LSTAT : 0)
+            | ((sim->phy[PHCON1] & PDPXMD) ? DPXSTAT : 0);
+        break;
+    case PHSTAT1:
+        v = 0x1800 | (sim->link ? bit(2) : 0);
+        break;
+    case PHIR:
+        sim->phy[PHIR] = 0;
+        break;
+    }
+
+    return v;
+}
+
+static void phy_write(enc28j60_sim_t *sim, uint8_t addr, uint16_t v)
+{
+    switch (addr) {
+    case PHCON1:
+        if (v & PRST) {
+            phy_reset(sim);
+            return;
+        }
+        break;
+    case PHSTAT1:
+    case PHSTAT2:
+    case PHID1:
+    case PHID2:
+    case PHIR:
+        return;
+    }
+    sim->phy[addr & 0x1F] = v;
+}
+
+static uint8_t eir(enc28j60_sim_t *sim)
+{
+    uint8_t v = *reg(sim, EIR) & ~(PKTIF|LINKIF);
+    if (*reg(sim, EPKTCNT) > 0) {
+        v |= PKTIF;
+    }
+    if ((sim->phy[PHIR] & PGIF) && (sim->phy[PHIE] & PGEIE)) {
+        v |= LINKIF;
+    }
+    return v;
+}
+
+static uint8_t read_reg(enc28j60_sim_t *sim, uint8_t id)
+{
+    switch (id & 0x1F) {
+    case EIR:
+        return eir(sim);
+    case ESTAT:
+        return (*reg(sim, ESTAT) & ~INT)
+            | ((eir(sim) & *reg(sim, EIE) & 0x7F) ? INT : 0);
+    }
+    return *reg(sim, id);
+}
+
+
+//# checksum, crc
+static uint16_t checksum(const uint8_t *data, uint32_t size)
+{
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < size; ++i) {
+        sum += (i & 1) ? data[i] : (data[i] << 8);
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return ~sum;
+}
+
+static uint32_t crc32_raw(uint32_t crc, const uint8_t *data, uint32_t size)
+{
+    while (size--) {
+        crc ^= *data++;
+        for (int k = 0; k < 8; ++k) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return crc;
+}
+
+// The hash table filter crc: polynomial 0x04C11DB7 shifted msb first, 
+// the data bits lsb first, no final inversion.
+static uint32_t crc32_msb(const uint8_t *data, uint32_t size)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    while (size--) {
+        for (int k = 0; k < 8; ++k) {
+            uint32_t bit = (crc >> 31) ^ ((*data >> k) & 1);
+            crc = (crc << 1) ^ (0x04C11DB7 & -bit);
+        }
+        ++data;
+    }
+    return crc;
+}
+
+uint32_t enc28j60_sim_crc32(const uint8_t *data, uint32_t size)
+{
+    return ~crc32_raw(0xFFFFFFFF, data, size);
+}
+
+
+//# dma
+static inline uint16_t dma_next(enc28j60_sim_t *sim, uint16_t ptr)
+{
+    if (ptr == get16(sim, ERXNDL)) {
+        return get16(sim, ERXSTL);
+    }
+    return (ptr + 1) & 0x1FFF;
+}
+
+static void dma(enc28j60_sim_t *sim, uint8_t econ1)
+{
+    static uint8_t buff[8192];
+    uint16_t src = get16(sim, EDMASTL);
+    uint16_t end = get16(sim, EDMANDL);
+    uint16_t dst = get16(sim, EDMADSTL);
+    uint32_t n = 0;
+
+    for (;;) {
+        buff[n++] = sim->mem[src];
+        if (src == end || n == sizeof(buff)) {
+            break;
+        }
+        src = dma_next(sim, src);
+    }
+
+    if (econ1 & CSUMEN) {
+        uint16_t cs = checksum(buff, n);
+        *reg(sim, EDMACSL) = cs & 0xFF;
+        *reg(sim, EDMACSH) = cs >> 8;
+    }
+    else {
+        for (uint32_t i = 0; i < n; ++i) {
+            sim->mem[dst] = buff[i];
+            dst = dma_next(sim, dst);
+        }
+    }
+
+    // about 2 bytes per instruction clock (40ns)
+    sim->now += n * 20;
+    *reg(sim, EIR) |= DMAIF;
+}
+
+
+//# receive
+static int filter(enc28j60_sim_t *sim, const uint8_t *f, uint32_t n,
+    int crc_ok)
+{
+    uint8_t fcon = *reg(sim, ERXFCON);
+    uint8_t mac[6] = {
+        *reg(sim, MAADR1), *reg(sim, MAADR2), *reg(sim, MAADR3),
+        *reg(sim, MAADR4), *reg(sim, MAADR5), *reg(sim, MAADR6),
+    };
+    static const uint8_t bcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    int and_mode = fcon & bit(6);
+    int any = 0, all = 1, m;
+
+    if ((fcon & bit(5)) && !crc_ok) {
+        return 0;
+    }
+
+    #define MATCH(en, cond) \
+        if (fcon & (en)) { m = (cond); any |= m; all &= m; }
+
+    MATCH(bit(7), memcmp(f, mac, 6) == 0);
+    MATCH(bit(0), memcmp(f, bcast, 6) == 0);
+    MATCH(bit(1), (f[0] & 1) && memcmp(f, bcast, 6) != 0);
+    if (fcon & bit(2)) {
+        uint32_t ptr = (crc32_msb(f, 6) >> 23) & 0x3F;
+        m = (*reg(sim, EHT0 + (ptr >> 3)) >> (ptr & 7)) & 1;
+        any |= m; all &= m;
+    }
+    if (fcon & bit(4)) {
+        uint8_t sel[64];
+        uint32_t off = get16(sim, EPMOL), cnt = 0;
+        m = 0;
+        if (off + 64 <= n) {
+            for (int i = 0; i < 64; ++i) {
+                if ((*reg(sim, EPMM0 + (i >> 3)) >> (i & 7)) & 1) {
+                    sel[cnt++] = f[off + i];
+                }
+            }
+            m = checksum(sel, cnt) ==
+                (*reg(sim, EPMCSL) | (*reg(sim, EPMCSL+1) << 8));
+        }
+        any |= m; all &= m;
+    }
+    // magic packet filter is not emulated
+    #undef MATCH
+
+    if ((fcon & 0x9F) == 0) {
+        return 1;
+    }
+    return and_mode ? all : any;
+}
+
+static int rx_raw(enc28j60_sim_t *sim, const uint8_t *f, uint32_t n)
+{
+    uint16_t st = get16(sim, ERXSTL), nd = get16(sim, ERXNDL);
+    uint16_t wr = get16(sim, ERXWRPTL), rd = get16(sim, ERXRDPTL);
+    uint32_t size = nd - st + 1;
+    uint32_t free, need, i;
+    uint16_t next, status, type, p;
+    uint8_t hdr[6];
+    int crc_ok;
+
+    if (!(*reg(sim, ECON1) & RXEN)) {
+        return 0;
+    }
+
+    crc_ok = n >= 4 && enc28j60_sim_crc32(f, n-4) == (uint32_t)(f[n-4] 
+        | (f[n-3]<<8) | (f[n-2]<<16) | ((uint32_t)f[n-1]<<24));
+    if (n < 18 || !filter(sim, f, n, crc_ok)) {
+        ++sim->rx_filtered;
+        return 0;
+    }
+
+    // the hardware never writes at ERXRDPT
+    free = (rd - wr - 1 + size) % size;
+    need = 6 + n;
+    need += need & 1;
+    if (need > free || *reg(sim, EPKTCNT) == 255) {
+        *reg(sim, EIR) |= RXERIF;
+        ++sim->rx_overflows;
+        return 0;
+    }
+
+    next = st + (wr - st + need) % size;
+    // crc error, length check error (an 802.3 length field other than the
+    // data size, padding aside), length out of range (a type field)
+    type = (f[12] << 8) | f[13];
+    status = 0;
+    if (!crc_ok) {
+        status |= bit(4);
+    }
+    if (type > 1500) {
+        status |= bit(6);
+    }
+    else if (type != n - 18 && !(type < 46 && n == 64)) {
+        status |= bit(5);
+    }
+    if (crc_ok) {
+        status |= bit(7); // received ok: crc, no symbol error
+    }
+    hdr[0] = next & 0xFF;
+    hdr[1] = next >> 8;
+    hdr[2] = n & 0xFF;
+    hdr[3] = n >> 8;
+    hdr[4] = status;
+    hdr[5] = !(f[0] & 1) ? 0 
+        : memcmp(f, "\xFF\xFF\xFF\xFF\xFF\xFF", 6) ? 1 : 2;
+
+    p = wr;
+    for (i = 0; i < 6 + n; ++i) {
+        sim->mem[p] = i < 6 ? hdr[i] : f[i-6];
+        p = p == nd ? st : p + 1;
+    }
+    set16(sim, ERXWRPTL, next);
+    *reg(sim, EPKTCNT) += 1;
+    ++sim->rx_frames;
+
+    return 1;
+}
+
+
+//# transmit
+static void tx_start(enc28j60_sim_t *sim)
+{
+    static uint8_t frame[2048];
+    uint16_t st = get16(sim, ETXSTL), nd = get16(sim, ETXNDL);
+    uint8_t ctrl = sim->mem[st];
+    uint8_t macon3 = *reg(sim, MACON3);
+    uint32_t len = (nd - st) & 0x1FFF;
+    int crcen, pad;
+    uint32_t crc;
+
+    if (len > sizeof(frame) - 64) {
+        len = sizeof(frame) - 64;
+    }
+    memcpy(frame, &sim->mem[st+1], len);
+
+    if (ctrl & bit(0)) {
+        crcen = ctrl & bit(1);
+        pad = ctrl & bit(2);
+    }
+    else {
+        crcen = macon3 & TXCRCEN;
+        pad = macon3 & 0xE0;
+    }
+    if (pad && len < 60) {
+        memset(frame + len, 0, 60 - len);
+        len = 60;
+    }
+    if (crcen) {
+        crc = enc28j60_sim_crc32(frame, len);
+        frame[len++] = crc;
+        frame[len++] = crc >> 8;
+        frame[len++] = crc >> 16;
+        frame[len++] = crc >> 24;
+    }
+
+    sim->tx_active = 1;
+    // preamble + sfd, frame, inter packet gap at 10Mbps
+    sim->tx_done_at = sim->now + (8 + len + 12) * 800ull;
+    sim->tx_len = len;
+    sim->tx_frame = frame;
+}
+
+static void tx_done(enc28j60_sim_t *sim)
+{
+    uint16_t nd = get16(sim, ETXNDL);
+    uint32_t len = sim->tx_len;
+    uint8_t *frame = sim->tx_frame;
+    uint8_t tsv[7] = { 0 };
+
+    sim->tx_active = 0;
+    *reg(sim, ECON1) &= ~TXRTS;
+    *reg(sim, EIR) |= TXIF;
+
+    tsv[0] = len & 0xFF;
+    tsv[1] = len >> 8;
+    tsv[2] = bit(7); // done
+    if (frame[0] & 1) {
+        tsv[3] = memcmp(frame, "\xFF\xFF\xFF\xFF\xFF\xFF", 6) ? 1 : 2;
+    }
+    tsv[4] = (len + 8) & 0xFF;
+    tsv[5] = (len + 8) >> 8;
+    for (int i = 0; i < 7; ++i) {
+        sim->mem[(nd + 1 + i) & 0x1FFF] = tsv[i];
+    }
+
+    ++sim->tx_frames;
+    // looped back inside the phy, nothing on the wire
+    if (sim->phy[PHCON1] & PLOOPBK) {
+        rx_raw(sim, frame, len);
+    }
+    else if (sim->tx_sink) {
+        sim->tx_sink(sim, frame, len);
+    }
+}
+
+
+//# flow control
+static int flow_blocked(enc28j60_sim_t *sim)
+{
+    uint8_t fcen = *reg(sim, EFLOCON) & 0x03;
+
+    if (!(*reg(sim, MACON3) & FULDPX)) {
+        return fcen & 0x01; // backpressure
+    }
+    return fcen == 0x02 || sim->now < sim->paused_until;
+}
+
+static void flow_control(enc28j60_sim_t *sim, uint8_t fcen)
+{
+    uint16_t epaus = *reg(sim, EPAUSL) | (*reg(sim, EPAUSL+1) << 8);
+
+    if (!(*reg(sim, MACON3) & FULDPX)) {
+        return;
+    }
+    switch (fcen & 0x03) {
+    case 0x01: // one pause frame, then off
+        ++sim->pause_frames;
+        sim->paused_until = sim->now + epaus * 51200ull;
+        *reg(sim, EFLOCON) &= ~0x03;
+        break;
+    case 0x02: // periodic pause frames
+        ++sim->pause_frames;
+        break;
+    case 0x03: // one zero-time pause frame, then off
+        ++sim->pause_frames;
+        sim->paused_until = sim->now;
+        *reg(sim, EFLOCON) &= ~0x03;
+        break;
+    }
+}
+
+static void write_reg(enc28j60_sim_t *sim, uint8_t id, uint8_t v)
+{
+    uint8_t *r = reg(sim, id);
+    uint8_t old = *r;
+
+    switch (id & 0x1F) {
+    case ECON1:
+        if (v & TXRST) {
+            sim->tx_active = 0;
+            sim->tx_stuck = 0;
+            v &= ~TXRTS;
+        }
+        if (v & RXRST) {
+            v &= ~RXEN;
+            *reg(sim, EPKTCNT) = 0;
+            set16(sim, ERXWRPTL, get16(sim, ERXSTL));
+        }
+        *r = v;
+        if ((v & TXRTS) && !(old & TXRTS)) {
+            tx_start(sim);
+        }
+        if ((old & DMAST) && !(v & DMAST)) {
+            sim->dma_stuck = 0;
+        }
+        else if ((v & DMAST) && !sim->dma_stuck) {
+            dma(sim, v);
+            *r &= ~DMAST;
+        }
+        return;
+    case ECON2:
+        if ((v & PKTDEC) && *reg(sim, EPKTCNT) > 0) {
+            *reg(sim, EPKTCNT) -= 1;
+        }
+        *r = v & ~PKTDEC;
+        return;
+    case EIR:
+        *r = v & ~(PKTIF|LINKIF);
+        return;
+    case ESTAT:
+        *r = (old & CLKRDY) | (v & ~CLKRDY & ~INT);
+        return;
+    case EIE:
+        *r = v;
+        return;
+    }
+
+    if (id == EPKTCNT || id == MISTAT || id == EREVID) {
+        return;
+    }
+
+    *r = v;
+    if (id == ERXSTL || id == ERXSTH) {
+        set16(sim, ERXWRPTL, get16(sim, ERXSTL));
+    }
+    else if (id == MICMD && (v & bit(0))) {
+        uint16_t d = phy_read(sim, *reg(sim, MIREGADR));
+        *reg(sim, MIRDL) = d & 0xFF;
+        *reg(sim, MIRDH) = d >> 8;
+    }
+    else if (id == MIWRH) {
+        phy_write(sim, *reg(sim, MIREGADR), *reg(sim, MIWRL) | (v << 8));
+    }
+    else if (id == EFLOCON) {
+        flow_control(sim, v);
+    }
+}
+
+
+//# spi
+static uint8_t xfer(enc28j60_sim_t *sim, uint8_t mosi)
+{
+    uint8_t op, arg, id, v = 0;
+    uint16_t ptr;
+
+    ++sim->spi_bytes;
+    sim->now += sim->spi_byte_ns;
+    tick(sim);
+
+    if (!sim->cs) {
+        return 0xFF;
+    }
+
+    if (sim->nbytes++ == 0) {
+        sim->op = mosi;
+        if (mosi == 0xFF) {
+            reset(sim);
+        }
+        return 0;
+    }
+
+    op = sim->op >> 5;
+    arg = sim->op & 0x1F;
+    id = (arg >= 0x1B) ? arg : R(*reg(sim, ECON1) & 0x03, arg);
+
+    switch (op) {
+    case OP_RCR:
+        if (is_mac_mii(id) && sim->nbytes == 2) {
+            return 0; // dummy byte
+        }
+        return read_reg(sim, id);
+    case OP_RBM:
+        ptr = get16(sim, ERDPTL);
+        v = sim->mem[ptr];
+        if (*reg(sim, ECON2) & AUTOINC) {
+            ptr = ptr == get16(sim, ERXNDL) ? get16(sim, ERXSTL)
+                : (ptr + 1) & 0x1FFF;
+            set16(sim, ERDPTL, ptr);
+        }
+        return v;
+    case OP_WCR:
+        if (sim->nbytes == 2) {
+            write_reg(sim, id, mosi);
+        }
+        return 0;
+    case OP_WBM:
+        ptr = get16(sim, EWRPTL);
+        sim->mem[ptr] = mosi;
+        if (*reg(sim, ECON2) & AUTOINC) {
+            set16(sim, EWRPTL, ptr + 1);
+        }
+        return 0;
+    case OP_BFS:
+    case OP_BFC:
+        if (sim->nbytes == 2 && !is_mac_mii(id)) {
+            v = *reg(sim, id);
+            write_reg(sim, id, op == OP_BFS ? (v | mosi) : (v & ~mosi));
+        }
+        return 0;
+    }
+
+    return 0;
+}
+
+void gpio_clear(gpio_t *gpio)
+{
+    enc28j60_sim_t *sim = gpio->sim;
+
+    if (!sim->cs) {
+        sim->cs = 1;
+        sim->nbytes = 0;
+        ++sim->spi_transactions;
+        sim->now += sim->spi_cs_ns;
+    }
+}
+
+void gpio_set(gpio_t *gpio)
+{
+    gpio->sim->cs = 0;
+}
+
+uint32_t spi_write(spi_t *spi, uint8_t *data, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; ++i) {
+        xfer(spi->sim, data[i]);
+    }
+    return size;
+}
+
+uint32_t spi_read(spi_t *spi, uint8_t *buff, uint32_t size)
+{
+    uint8_t flip = 0;
+
+    if (spi->sim->read_fault && spi->sim->read_fault == size) {
+        spi->sim->read_fault = 0;
+        if (!spi->sim->read_flip) {
+            return 0;
+        }
+        flip = 0xFF;
+    }
+    for (uint32_t i = 0; i < size; ++i) {
+        buff[i] = xfer(spi->sim, 0) ^ flip;
+    }
+    return size;
+}
+
+
+//# time
+static void tick(enc28j60_sim_t *sim)
+{
+    enc28j60_sim_frame_t *f;
+
+    if (sim->tx_active && !sim->tx_stuck && sim->now >= sim->tx_done_at) {
+        tx_done(sim);
+    }
+
+    while (sim->queue_head != sim->queue_tail) {
+        f = &sim->queue[sim->queue_head];
+        // one frame at a time on the wire: preamble, fcs and gap included
+        if (f->at < sim->rx_wire_free) {
+            f->at = sim->rx_wire_free;
+        }
+        if (f->at > sim->now) {
+            break;
+        }
+        if (flow_blocked(sim)) {
+            // the sender holds the frame back
+            sim->backpressure_ns += sim->now - f->at;
+            f->at = sim->now;
+            break;
+        }
+        sim->rx_wire_free = f->at + (f->size + 24) * 800ull;
+        rx_raw(sim, f->data, f->size);
+        free(f->data);
+        sim->queue_head = (sim->queue_head + 1) % sim->queue_cap;
+    }
+}
+
+enc28j60_sim_t *enc28j60_sim_clock;
+
+void enc28j60_sim_init(enc28j60_sim_t *sim)
+{
+    memset(sim->mem, 0, sizeof(sim->mem));
+    sim->cs = 0;
+    sim->now = 0;
+    sim->spi_transactions = 0;
+    sim->spi_bytes = 0;
+    sim->rx_frames = 0;
+    sim->rx_overflows = 0;
+    sim->rx_filtered = 0;
+    sim->tx_frames = 0;
+    sim->pause_frames = 0;
+    sim->backpressure_ns = 0;
+    sim->read_fault = 0;
+    sim->read_flip = 0;
+    sim->tx_stuck = 0;
+    sim->dma_stuck = 0;
+    // frames left on the wire belong to the old clock
+    sim->queue_head = sim->queue_tail = 0;
+    enc28j60_sim_clock = sim;
+    sim->link = 1;
+    if (!sim->spi_byte_ns) {
+        sim->spi_byte_ns = 1000;
+    }
+    reset(sim);
+}
+
+int enc28j60_sim_schedule_rx(enc28j60_sim_t *sim,
+    uint64_t at, const uint8_t *frame, uint32_t size)
+{
+    enc28j60_sim_frame_t *f;
+    uint32_t crc, n = size < 60 ? 60 : size;
+
+    if ((sim->queue_tail + 1) % (sim->queue_cap ? sim->queue_cap : 1)
+        == sim->queue_head) {
+        uint32_t cap = sim->queue_cap ? sim->queue_cap * 2 : 1024;
+        enc28j60_sim_frame_t *q = malloc(cap * sizeof(*q));
+        uint32_t cnt = 0;
+        if (!q) {
+            return 0;
+        }
+        while (sim->queue_head != sim->queue_tail) {
+            q[cnt++] = sim->queue[sim->queue_head];
+            sim->queue_head = (sim->queue_head + 1) % sim->queue_cap;
+        }
+        free(sim->queue);
+        sim->queue = q;
+        sim->queue_cap = cap;
+        sim->queue_head = 0;
+        sim->queue_tail = cnt;
+    }
+
+    // padded and with fcs as on the wire
+    f = &sim->queue[sim->queue_tail];
+    f->at = at;
+    f->size = n + 4;
+    f->data = calloc(1, n + 4);
+    memcpy(f->data, frame, size);
+    crc = enc28j60_sim_crc32(f->data, n);
+    f->data[n] = crc;
+    f->data[n+1] = crc >> 8;
+    f->data[n+2] = crc >> 16;
+    f->data[n+3] = crc >> 24;
+    sim->queue_tail = (sim->queue_tail + 1) % sim->queue_cap;
+
+    tick(sim);
+
+    return 1;
+}
+
+uint32_t enc28j60_sim_pending(enc28j60_sim_t *sim)
+{
+    if (!sim->queue_cap) {
+        return 0;
+    }
+    return (sim->queue_tail - sim->queue_head + sim->queue_cap)
+        % sim->queue_cap;
+}
+
+void enc28j60_sim_advance(enc28j60_sim_t *sim, uint64_t ns)
+{
+    sim->now += ns;
+    tick(sim);
+}
+
+uint32_t enc28j60_sim_clock_us(void)
+{
+    return enc28j60_sim_clock ? enc28j60_sim_clock->now / 1000 : 0;
+}
+
+int enc28j60_sim_int(enc28j60_sim_t *sim)
+{
+    return (*reg(sim, EIE) & INTIE) && (read_reg(sim, ESTAT) & INT);
+}
+
+void enc28j60_sim_set_link(enc28j60_sim_t *sim, int up)
+{
+    if (sim->link != !!up) {
+        sim->link = !!up;
+        sim->phy[PHIR] |= PLNKIF;
+        if (sim->phy[PHIE] & PLNKIE) {
+            sim->phy[PHIR] |= PGIF;
+        }
+    }
+}
+
+
+//# pcap
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static uint32_t get32(const uint8_t *p, int swap)
+{
+    if (swap) {
+        return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    }
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int pcap_swapped;
+
+FILE *pcap_open_read(const char *path)
+{
+    uint8_t hdr[24];
+    FILE *fp = fopen(path, "rb");
+
+    if (fp) {
+        if (fread(hdr, 1, 24, fp) != 24) {
+            fclose(fp);
+            return 0;
+        }
+        pcap_swapped = get32(hdr, 0) == 0xD4C3B2A1;
+        if (get32(hdr, pcap_swapped) != 0xA1B2C3D4) {
+            fclose(fp);
+            return 0;
+        }
+    }
+    return fp;
+}
+
+FILE *pcap_open_write(const char *path)
+{
+    uint8_t hdr[24] = { 0 };
+    FILE *fp = fopen(path, "wb");
+
+    if (fp) {
+        put32(hdr, 0xA1B2C3D4);
+        hdr[4] = 2; // version 2.4
+        hdr[6] = 4;
+        put32(hdr + 16, 65535);
+        put32(hdr + 20, 1); // ethernet
+        fwrite(hdr, 1, 24, fp);
+    }
+    return fp;
+}
+
+uint32_t pcap_read(FILE *fp, uint64_t *ts, uint8_t *buff, uint32_t size)
+{
+    uint8_t rec[16];
+    uint32_t incl, keep;
+
+    if (fread(rec, 1, 16, fp) != 16) {
+        return 0;
+    }
+    *ts = get32(rec, pcap_swapped) * 1000000000ull
+        + get32(rec + 4, pcap_swapped) * 1000ull;
+    incl = get32(rec + 8, pcap_swapped);
+    keep = incl < size ? incl : size;
+    if (fread(buff, 1, keep, fp) != keep) {
+        return 0;
+    }
+    fseek(fp, incl - keep, SEEK_CUR);
+    return keep;
+}
+
+void pcap_write(FILE *fp, uint64_t ts, const uint8_t *frame, uint32_t size)
+{
+    uint8_t rec[16];
+
+    put32(rec, ts / 1000000000ull);
+    put32(rec + 4, (ts / 1000) % 1000000);
+    put32(rec + 8, size);
+    put32(rec + 12, size);
+    fwrite(rec, 1, 16, fp);
+    fwrite(frame, 1, size, fp);
+}
+
+/****************************** Copy right 2026 *******************************/
@@ -0,0 +1,112 @@
+/**
+  ******************************************************************************
+  * \brief      host-side enc28j60 simulator
+  * \file       enc28j60_sim.h
+  * \author     doerthous
+  * \date       2026-10-19
+  * \details    Emulates an enc28j60 behind spi.h/gpio.h: register banks,
+  *             buffer memory with auto-increment, the receive ring, MII/PHY
+  *             registers, transmit status vectors, the DMA engine, the 
+  *             receive filters, flow control and PHY loopback. Time is 
+  *             simulated: spi bytes and wire time advance the clock. The 
+  *             traffic can come from and go to pcap files.
+  ******************************************************************************
+  */
+
+#ifndef ENC28J60_SIM_H_
+#define ENC28J60_SIM_H_
+
+#include <stdint.h>
+
+typedef struct enc28j60_sim_frame
+{
+    uint64_t at; // ns
+    uint32_t size;
+    uint8_t *data; // without fcs
+} enc28j60_sim_frame_t;
+
+typedef struct enc28j60_sim
+{
+    uint32_t spi_byte_ns; // 1000: 8MHz sck
+    uint32_t spi_cs_ns; // per transaction overhead
+    uint8_t link:1;
+    uint8_t trace:1;
+    // transmitted frames, fcs included: appended by the mac (TXCRCEN)
+    // or already in the frame (tx_soft_fcs)
+    void (*tx_sink)(struct enc28j60_sim *sim,
+        const uint8_t *frame, uint32_t size);
+    // optional, run by delay_ms() as the interrupts would while waiting
+    void (*idle)(struct enc28j60_sim *sim);
+    void *arg;
+    // fault injection: the next spi_read of read_fault bytes returns 
+    // short, or its bytes inverted with read_flip, then read_fault is 
+    // cleared. With tx_stuck the transmissions never complete, TXRTS stays
+    // set, until TXRST clears tx_stuck. With dma_stuck the DMA does nothing
+    // and DMAST stays set, until it is cleared, which clears dma_stuck.
+    uint32_t read_fault;
+    uint8_t read_flip:1;
+    uint8_t tx_stuck:1;
+    uint8_t dma_stuck:1;
+
+    // statistics, cleared by enc28j60_sim_init
+    uint64_t now; // ns
+    uint32_t spi_transactions;
+    uint32_t spi_bytes;
+    uint32_t rx_frames; // written to the ring
+    uint32_t rx_overflows; // lost, ring full
+    uint32_t rx_filtered; // rejected by erxfcon
+    uint32_t tx_frames;
+    uint32_t pause_frames;
+    uint64_t backpressure_ns;
+
+    // internal
+    uint8_t mem[8192];
+    uint8_t regs[4][32];
+    uint16_t phy[32];
+    uint8_t cs;
+    uint8_t op;
+    uint32_t nbytes;
+    uint8_t tx_active;
+    uint64_t tx_done_at;
+    uint8_t *tx_frame;
+    uint32_t tx_len;
+    uint64_t paused_until;
+    uint64_t rx_wire_free;
+    enc28j60_sim_frame_t *queue;
+    uint32_t queue_head;
+    uint32_t queue_tail;
+    uint32_t queue_cap;
+} enc28j60_sim_t;
+
+// the last one powered on, delay_ms() lets its time pass
+extern enc28j60_sim_t *enc28j60_sim_clock;
+
+// power on, the frames still on the wire are dropped
+void enc28j60_sim_init(enc28j60_sim_t *sim);
+// a frame (fcs excluded) reaching the wire side at time at
+int enc28j60_sim_schedule_rx(enc28j60_sim_t *sim,
+    uint64_t at, const uint8_t *frame, uint32_t size);
+// frames still waiting on the wire
+uint32_t enc28j60_sim_pending(enc28j60_sim_t *sim);
+// let time pass without spi traffic
+void enc28j60_sim_advance(enc28j60_sim_t *sim, uint64_t ns);
+// simulated time, as the clock callback of the tests
+uint32_t enc28j60_sim_clock_us(void);
+// INT pin asserted
+int enc28j60_sim_int(enc28j60_sim_t *sim);
+// link state change
+void enc28j60_sim_set_link(enc28j60_sim_t *sim, int up);
+
+uint32_t enc28j60_sim_crc32(const uint8_t *data, uint32_t size);
+
+// pcap files, linktype ethernet
+#include <stdio.h>
+FILE *pcap_open_read(const char *path);
+FILE *pcap_open_write(const char *path);
+// return frame size, 0 at end of file
+uint32_t pcap_read(FILE *fp, uint64_t *ts, uint8_t *buff, uint32_t size);
+void pcap_write(FILE *fp, uint64_t ts, const uint8_t *frame, uint32_t size);
+
+#endif /* ENC28J60_SIM_H_ */
+
+/****************************** Copy right 2026 *******************************/
@@ -0,0 +1,28 @@
+/**
+  ******************************************************************************
+  * \brief      host-side gpio_t stand-in
+  * \file       gpio.h
+  * \author     doerthous
+  * \date       2026-10-19
+  * \details    Only the chip select of an emulated enc28j60.
+  ******************************************************************************
+  */
+
+#ifndef GPIO_H_
+#define GPIO_H_
+
+#include <stdint.h>
+
+struct enc28j60_sim;
+
+typedef struct
+{
+    struct enc28j60_sim *sim;
+} gpio_t;
+
+void gpio_set(gpio_t *gpio);
+void gpio_clear(gpio_t *gpio);
+
+#endif /* GPIO_H_ */
+
+/****************************** Copy right 2026 *******************************/
@@ -0,0 +1,29 @@
+/**
+  ******************************************************************************
+  * \brief      host-side delay stand-in
+  * \file       delay.h
+  * \author     doerthous
+  * \date       2026-10-19
+  * \details    Advance the simulated enc28j60 clock instead of sleeping,
+  *             then let the idle hook run.
+  ******************************************************************************
+  */
+
+#ifndef DELAY_H_
+#define DELAY_H_
+
+#include <enc28j60_sim.h>
+
+static inline void delay_ms(uint32_t ms)
+{
+    if (enc28j60_sim_clock) {
+        enc28j60_sim_advance(enc28j60_sim_clock, ms * 1000000ull);
+        if (enc28j60_sim_clock->idle) {
+            enc28j60_sim_clock->idle(enc28j60_sim_clock);
+        }
+    }
+}
+
+#endif /* DELAY_H_ */
+
+/****************************** Copy right 2026 *******************************/
@@ -0,0 +1,29 @@
+/**
+  ******************************************************************************
+  * \brief      host-side spi_t stand-in
+  * \file       spi.h
+  * \author     doerthous
+  * \date       2026-10-19
+  * \details    The spi bus is wired to an emulated enc28j60, see 
+  *             enc28j60_sim.h.
+  ******************************************************************************
+  */
+
+#ifndef SPI_H_
+#define SPI_H_
+
+#include <stdint.h>
+
+struct enc28j60_sim;
+
+typedef struct spi
+{
+    struct enc28j60_sim *sim;
+} spi_t;
+
+uint32_t spi_write(spi_t *spi, uint8_t *data, uint32_t size);
+uint32_t spi_read(spi_t *spi, uint8_t *buff, uint32_t size);
+
+#endif /* SPI_H_ */
+
+/****************************** Copy right 2026 *******************************/
@@ -2,6 +2,17 @@
 #include <string.h>
 
 #include "enc28j60.h"
+#include <lib/delay.h>
+
+//#
+#define USING_UART_PRINTF
+
+
+//#
+#if defined(USING_UART_PRINTF)
+  #include <lib/uart_printf.h>
+  #define printf(...) uart_printf(&uart1, ##__VA_ARGS__)
+#endif
 
 int enc28j60_test(enc28j60_t *enc28j60)
 {
@@ -11,3 +22,871 @@ int enc28j60_test(enc28j60_t *enc28j60)
     
     return 0;
 }
+
+// The functional tests below run in PHY loopback, without a cable: frames
+// sent to mac_addr come back through the receive filters.
+static int loopback_begin(enc28j60_t *enc28j60)
+{
+    enc28j60->phy_loopback = 1;
+    if (!enc28j60_init(enc28j60)) {
+        enc28j60->phy_loopback = 0;
+        return 0;
+    }
+    return 1;
+}
+
+static int loopback_end(enc28j60_t *enc28j60)
+{
+    enc28j60->phy_loopback = 0;
+    return enc28j60_init(enc28j60);
+}
+
+// A frame to ourselves with a local experimental ethertype, the payload 
+// depends on seed.
+static void test_frame(enc28j60_t *enc28j60, uint8_t *frame, uint32_t size,
+    uint8_t seed)
+{
+    memcpy(frame, enc28j60->mac_addr, 6);
+    memcpy(frame + 6, enc28j60->mac_addr, 6);
+    frame[12] = 0x88;
+    frame[13] = 0xB5;
+    for (uint32_t i = 14; i < size; ++i) {
+        frame[i] = seed + i * 13;
+    }
+}
+
+// Wait for a frame sent in loopback, 0 if none comes in 100ms. The frames
+// still queued are started meanwhile.
+static uint32_t loopback_recv(enc28j60_t *enc28j60, uint8_t *buff, 
+    uint32_t size)
+{
+    uint32_t len;
+
+    for (int i = 0; i < 100; ++i) {
+        if ((len = enc28j60_recv(enc28j60, buff, size)) > 0) {
+            return len;
+        }
+        enc28j60_tx_poll(enc28j60);
+        delay_ms(1);
+    }
+    return 0;
+}
+
+// The frames received, the first ones kept.
+static uint8_t rx_copy[4][1518];
+static uint32_t rx_copy_size[4], rx_copy_count;
+static void copy_handler(enc28j60_t *enc28j60, uint8_t *data, uint32_t size)
+{
+    (void)enc28j60;
+    if (rx_copy_count < 4) {
+        memcpy(rx_copy[rx_copy_count], data, size);
+        rx_copy_size[rx_copy_count] = size;
+    }
+    ++rx_copy_count;
+}
+
+static enc28j60_pbuf_t test_pbufs[2];
+static uint8_t test_pool_mem[2*1536];
+static enc28j60_pool_t test_pool = {
+    .pbufs = test_pbufs, .mem = test_pool_mem, .count = 2, .buff_size = 1536,
+};
+
+// Receive frames sent in loopback into rx_copy, through enc28j60_recv 
+// (path 0), enc28j60_recv_batch (1) or enc28j60_recv_pbuf (2), until 
+// frames came or 100ms passed.
+static void loopback_drain(enc28j60_t *enc28j60, int path, uint32_t frames)
+{
+    static uint8_t buff[1518];
+    enc28j60_pbuf_t *pbuf;
+    uint32_t len;
+
+    rx_copy_count = 0;
+    for (int i = 0; i < 100 && rx_copy_count < frames; ++i) {
+        if (path == 0) {
+            while ((len = enc28j60_recv(enc28j60, buff, sizeof(buff))) > 0) {
+                copy_handler(enc28j60, buff, len);
+            }
+        }
+        else if (path == 1) {
+            enc28j60_recv_batch(enc28j60, buff, sizeof(buff), copy_handler);
+        }
+        else {
+            while ((pbuf = enc28j60_recv_pbuf(enc28j60, &test_pool))) {
+                copy_handler(enc28j60, pbuf->data, pbuf->size);
+                enc28j60_pool_free(&test_pool, pbuf);
+            }
+        }
+        enc28j60_tx_poll(enc28j60);
+        delay_ms(1);
+    }
+}
+
+// Interrupt driven receive into a short buffer: the frames arrive intact,
+// the long one truncated, and rx_length tells. The interrupt is raised by 
+// hand, the INT pin is not needed.
+int enc28j60_rx_interrupt_test(enc28j60_t *enc28j60)
+{
+    static const uint16_t sizes[] = { 100, 1000 };
+    static uint8_t frame[1514], buff[600];
+    uint32_t keep;
+    int ok;
+
+    if (!loopback_begin(enc28j60)) {
+        return 0;
+    }
+    ok = enc28j60_rx_interrupt(enc28j60, buff, sizeof(buff), copy_handler);
+
+    for (unsigned i = 0; i < sizeof(sizes)/sizeof(sizes[0]) && ok; ++i) {
+        test_frame(enc28j60, frame, sizes[i], i);
+        rx_copy_count = 0;
+        ok = enc28j60_send(enc28j60, frame, sizes[i]);
+        for (int t = 0; t < 100 && ok && rx_copy_count == 0; ++t) {
+            delay_ms(1);
+            enc28j60_irq(enc28j60);
+            enc28j60_process(enc28j60);
+        }
+
+        keep = sizes[i] + 4U < sizeof(buff) ? sizes[i] + 4U : sizeof(buff);
+        ok = ok && rx_copy_count == 1 && rx_copy_size[0] == keep
+            && enc28j60->rx_length == sizes[i] + 4U
+            && memcmp(rx_copy[0], frame, 
+                keep < sizes[i] ? keep : sizes[i]) == 0;
+    }
+    enc28j60->rx_handler = 0;
+
+    return loopback_end(enc28j60) && ok;
+}
+
+// A blocking send followed by enc28j60_tx_wait() reports the frame sent.
+int enc28j60_tx_wait_test(enc28j60_t *enc28j60)
+{
+    static uint8_t frame[300], buff[1518];
+    int ok;
+
+    if (!loopback_begin(enc28j60)) {
+        return 0;
+    }
+
+    test_frame(enc28j60, frame, sizeof(frame), 0);
+    ok = enc28j60_send(enc28j60, frame, sizeof(frame))
+        && enc28j60_tx_wait(enc28j60)
+        && enc28j60->tx_status.byte_count == sizeof(frame) + 4
+        && loopback_recv(enc28j60, buff, sizeof(buff)) == sizeof(frame) + 4
+        && memcmp(buff, frame, sizeof(frame)) == 0;
+
+    return loopback_end(enc28j60) && ok;
+}
+
+// Hash table and pattern match filters: of two frames sent, only the 
+// matching one comes back, intact. The hash table bits are those of Linux
+// ether_crc() bits 28:23, as Microchip's SetRXHashTableEntry().
+int enc28j60_filter_test(enc28j60_t *enc28j60)
+{
+    static const struct {
+        uint8_t mac[6];
+        uint8_t bit;
+    } hash[] = {
+        { { 0x01, 0x00, 0x5E, 0x00, 0x00, 0x01 }, 63 },
+        { { 0x01, 0x00, 0x5E, 0x00, 0x00, 0x02 }, 4 },
+        { { 0x01, 0x00, 0x5E, 0x7F, 0xFF, 0xFA }, 28 },
+        { { 0x33, 0x33, 0x00, 0x00, 0x00, 0x01 }, 51 },
+        { { 0x01, 0x80, 0xC2, 0x00, 0x00, 0x00 }, 15 },
+    };
+    static uint8_t frame[2][128], buff[1518];
+    uint8_t table[8], mask[8] = { 0xFF }, pattern[64] = { 0 };
+    int ok = 1;
+
+    for (unsigned i = 0; i < sizeof(hash)/sizeof(hash[0]); ++i) {
+        memset(table, 0, sizeof(table));
+        enc28j60_hash_table_add(table, hash[i].mac);
+        for (int b = 0; b < 64; ++b) {
+            ok = ok && ((table[b >> 3] >> (b & 7)) & 1) == (b == hash[i].bit);
+        }
+    }
+
+    if (!loopback_begin(enc28j60)) {
+        return 0;
+    }
+
+    // hash: group 0 is in the table, group 1 is not
+    memset(table, 0, sizeof(table));
+    enc28j60_hash_table_add(table, hash[0].mac);
+    for (int i = 0; i < 2; ++i) {
+        test_frame(enc28j60, frame[i], sizeof(frame[i]), i);
+        memcpy(frame[i], hash[i].mac, 6);
+    }
+    ok = ok && enc28j60_set_hash_table(enc28j60, table)
+        && enc28j60_set_rx_filter(enc28j60, ENC28J60_RX_FILTER_HASH)
+        && enc28j60_send(enc28j60, frame[1], sizeof(frame[1]))
+        && enc28j60_send(enc28j60, frame[0], sizeof(frame[0]))
+        && loopback_recv(enc28j60, buff, sizeof(buff)) == sizeof(frame[0]) + 4
+        && memcmp(buff, frame[0], sizeof(frame[0])) == 0
+        && loopback_recv(enc28j60, buff, sizeof(buff)) == 0;
+
+    // pattern: the first 8 payload bytes
+    for (int i = 0; i < 2; ++i) {
+        test_frame(enc28j60, frame[i], sizeof(frame[i]), i);
+    }
+    memcpy(pattern, frame[1] + 14, 64);
+    ok = ok && enc28j60_set_pattern(enc28j60, 14, mask, pattern)
+        && enc28j60_set_rx_filter(enc28j60, ENC28J60_RX_FILTER_PATTERN)
+        && enc28j60_send(enc28j60, frame[0], sizeof(frame[0]))
+        && enc28j60_send(enc28j60, frame[1], sizeof(frame[1]))
+        && loopback_recv(enc28j60, buff, sizeof(buff)) == sizeof(frame[1]) + 4
+        && memcmp(buff, frame[1], sizeof(frame[1])) == 0
+        && loopback_recv(enc28j60, buff, sizeof(buff)) == 0;
+
+    return loopback_end(enc28j60) && ok;
+}
+
+static uint32_t type_classifier(enc28j60_t *enc28j60, 
+    const uint8_t *header, uint32_t size)
+{
+    (void)enc28j60;
+    (void)size;
+    switch (header[6+13]) {
+    case 0xB7:
+        return ENC28J60_RX_DROP;
+    case 0xB6:
+        return 64;
+    default:
+        return ENC28J60_RX_ACCEPT;
+    }
+}
+
+// The classifier drops, truncates and accepts frames by their type, on 
+// each receive path: only the kept bytes arrive, and they are intact.
+int enc28j60_classifier_test(enc28j60_t *enc28j60)
+{
+    static uint8_t frame[3][300];
+    uint32_t dropped;
+    int ok;
+
+    if (!loopback_begin(enc28j60)) {
+        return 0;
+    }
+    enc28j60->rx_classifier = type_classifier;
+    ok = enc28j60_pool_init(&test_pool);
+
+    for (int path = 0; path < 3 && ok; ++path) {
+        dropped = enc28j60->stats.rx_dropped;
+        for (int i = 0; i < 3 && ok; ++i) {
+            test_frame(enc28j60, frame[i], sizeof(frame[i]), path * 3 + i);
+            frame[i][13] = 0xB7 - i;
+            ok = enc28j60_send(enc28j60, frame[i], sizeof(frame[i]));
+        }
+        loopback_drain(enc28j60, path, 2);
+
+        ok = ok && rx_copy_count == 2
+            && enc28j60->stats.rx_dropped - dropped == 1
+            && rx_copy_size[0] == 64
+            && memcmp(rx_copy[0], frame[1], 64) == 0
+            && rx_copy_size[1] == sizeof(frame[2]) + 4
+            && memcmp(rx_copy[1], frame[2], sizeof(frame[2])) == 0;
+    }
+    enc28j60->rx_classifier = 0;
+
+    return loopback_end(enc28j60) && ok;
+}
+
+// enc28j60_pack() by copy with an 802.3 length field and padding, then in
+// place with a type; the frame goes out in three segments through 
+// enc28j60_sendv() and enc28j60_unpack() reads it back.
+int enc28j60_pack_test(enc28j60_t *enc28j60)
+{
+    static uint8_t data[1518], payload[100], buff[1518];
+    enc28j60_iovec_t iov[3] = { 
+        { data, 14 }, { data + 14, 50 }, { data + 64, 50 } 
+    };
+    enc28j60_packet_t packet;
+    int ok;
+
+    for (unsigned i = 0; i < sizeof(payload); ++i) {
+        payload[i] = i * 3 + 1;
+    }
+    memset(&packet, 0, sizeof(packet));
+    memcpy(packet.dist_mac_addr, enc28j60->mac_addr, 6);
+    memcpy(packet.src_mac_addr, enc28j60->mac_addr, 6);
+    packet.data = data;
+
+    memset(data, 0xAA, sizeof(data));
+    packet.payload = payload;
+    packet.payload_size = 20;
+    packet.type = 0;
+    ok = enc28j60_pack(&packet) && packet.payload_size == 20
+        && packet.data_size == 60
+        && memcmp(data, enc28j60->mac_addr, 6) == 0
+        && memcmp(data + 6, enc28j60->mac_addr, 6) == 0
+        && data[12] == 0 && data[13] == 20
+        && memcmp(data + 14, payload, 20) == 0;
+    for (int i = 34; i < 60; ++i) {
+        ok = ok && data[i] == 0;
+    }
+
+    memcpy(data + ENC28J60_HEADER_SIZE, payload, sizeof(payload));
+    packet.payload = data + ENC28J60_HEADER_SIZE;
+    packet.payload_size = sizeof(payload);
+    packet.type = 0x88B5;
+    ok = ok && enc28j60_pack(&packet) && packet.data_size == 114
+        && data[12] == 0x88 && data[13] == 0xB5
+        && memcmp(data + 14, payload, sizeof(payload)) == 0;
+
+    if (!loopback_begin(enc28j60)) {
+        return 0;
+    }
+    ok = ok && enc28j60_sendv(enc28j60, iov, 3)
+        && loopback_recv(enc28j60, buff, sizeof(buff)) == 118
+        && memcmp(buff, data, 114) == 0;
+
+    memset(&packet, 0, sizeof(packet));
+    packet.data = buff;
+    packet.data_size = 118;
+    packet.fcs = 1;
+    ok = ok && enc28j60_unpack(&packet) && packet.type == 0x88B5
+        && memcmp(packet.src_mac_addr, enc28j60->mac_addr, 6) == 0
+        && packet.payload == buff + 14 && packet.payload_size == 100
+        && memcmp(packet.payload, payload, sizeof(payload)) == 0;
+
+    // a bad FCS is only seen when asked for
+    buff[20] ^= 1;
+    ok = ok && !enc28j60_unpack(&packet);
+    packet.fcs = 0;
+    ok = ok && enc28j60_unpack(&packet);
+
+    return loopback_end(enc28j60) && ok;
+}
+
+// One's complement sum in network byte order, folded.
+static uint16_t sum16(uint32_t sum, const uint8_t *data, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; ++i) {
+        sum += (i & 1) ? data[i] : (data[i] << 8);
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return sum;
+}
+
+// IPv4 and UDP checksums by the DMA engine, the UDP payload of odd size: 
+// the frame received must carry the checksums of a software reference and
+// be otherwise unchanged.
+int enc28j60_checksum_test(enc28j60_t *enc28j60)
+{
+    static const uint8_t ip[20] = {
+        0x45, 0x00, 0x00, 0x3D, 0x00, 0x00, 0x40, 0x00, 0x40, 0x11,
+        0x00, 0x00, 10, 0, 0, 1, 10, 0, 0, 2,
+    };
+    static uint8_t frame[14+20+8+33], buff[1518];
+    enc28j60_iovec_t iov = { frame, sizeof(frame) };
+    uint8_t pseudo[12];
+    uint16_t csum, udp_len = 8 + 33;
+    int ok;
+
+    test_frame(enc28j60, frame, sizeof(frame), 0);
+    frame[12] = 0x08;
+    frame[13] = 0x00;
+    memcpy(frame + 14, ip, 20);
+    frame[34] = 0x04; // ports 1234, 5678
+    frame[35] = 0xD2;
+    frame[36] = 0x16;
+    frame[37] = 0x2E;
+    frame[38] = udp_len >> 8;
+    frame[39] = udp_len & 0xFF;
+
+    // the udp checksum field holds the pseudo header sum
+    memcpy(pseudo, ip + 12, 8);
+    pseudo[8] = 0;
+    pseudo[9] = 0x11;
+    pseudo[10] = udp_len >> 8;
+    pseudo[11] = udp_len & 0xFF;
+    csum = sum16(0, pseudo, 12);
+    frame[40] = csum >> 8;
+    frame[41] = csum & 0xFF;
+
+    if (!loopback_begin(enc28j60)) {
+        return 0;
+    }
+    ok = enc28j60_tx_prepare(enc28j60, &iov, 1)
+        && enc28j60_tx_checksum(enc28j60, 14, 20, 24)
+        && enc28j60_tx_checksum(enc28j60, 34, udp_len, 40)
+        && enc28j60_tx_commit(enc28j60)
+        && loopback_recv(enc28j60, buff, sizeof(buff)) == sizeof(frame) + 4;
+
+    csum = ~sum16(0, frame + 14, 20);
+    frame[24] = csum >> 8;
+    frame[25] = csum & 0xFF;
+    csum = ~sum16(0, frame + 34, udp_len);
+    if (csum == 0) {
+        csum = 0xFFFF;
+    }
+    frame[40] = csum >> 8;
+    frame[41] = csum & 0xFF;
+    ok = ok && memcmp(buff, frame, sizeof(frame)) == 0
+        && sum16(0, buff + 14, 20) == 0xFFFF
+        && sum16(sum16(0, pseudo, 12), buff + 34, udp_len) == 0xFFFF;
+
+    return loopback_end(enc28j60) && ok;
+}
+
+// enc28j60_rx_forward() with a new source address: the forwarded frame 
+// comes back with the new header and the payload intact, and the frame 
+// pending behind it in the ring is left alone. 20 rounds wrap the receive
+// ring, so the DMA copy crosses its end too. A frame skipped by 
+// enc28j60_rx_skip() is gone.
+int enc28j60_forward_test(enc28j60_t *enc28j60)
+{
+    static const uint8_t src[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x99 };
+    static uint8_t frame[2][400], buff[1518];
+    uint8_t header[12];
+    uint32_t size;
+    int ok;
+
+    if (!loopback_begin(enc28j60)) {
+        return 0;
+    }
+
+    ok = 1;
+    for (int i = 0; i < 20 && ok; ++i) {
+        size = 300 + i * 5;
+        for (int j = 0; j < 2 && ok; ++j) {
+            test_frame(enc28j60, frame[j], size, i * 2 + j);
+            ok = enc28j60_send(enc28j60, frame[j], size)
+                && enc28j60_tx_wait(enc28j60);
+        }
+        ok = ok && enc28j60_rx_peek(enc28j60, header, 12) == size + 4
+            && memcmp(header, frame[0], 12) == 0;
+
+        memcpy(header + 6, src, 6);
+        ok = ok && enc28j60_rx_forward(enc28j60, header, 12)
+            && enc28j60_tx_commit(enc28j60)
+            && loopback_recv(enc28j60, buff, sizeof(buff)) == size + 4
+            && memcmp(buff, frame[1], size) == 0
+            && loopback_recv(enc28j60, buff, sizeof(buff)) == size + 4
+            && memcmp(buff, header, 12) == 0
+            && memcmp(buff + 12, frame[0] + 12, size - 12) == 0;
+    }
+
+    test_frame(enc28j60, frame[0], 100, 0);
+    ok = ok && enc28j60_send(enc28j60, frame[0], 100)
+        && enc28j60_tx_wait(enc28j60)
+        && enc28j60_rx_skip(enc28j60)
+        && loopback_recv(enc28j60, buff, sizeof(buff)) == 0;
+
+    return loopback_end(enc28j60) && ok;
+}
+
+// With a software FCS and no receive filter, a frame with a bad FCS and 
+// one whose 802.3 length field is wrong still arrive, intact, and count as 
+// errors on each receive path, a good frame does not. Then frames sent 
+// faster than read overflow the ring: RXERIF is counted without interrupts.
+int enc28j60_rx_error_test(enc28j60_t *enc28j60)
+{
+    static uint8_t frame[3][200], flood[1000];
+    enc28j60_stats_t before;
+    uint32_t crc;
+    int ok;
+
+    enc28j60->tx_soft_fcs = 1;
+    if (!loopback_begin(enc28j60)) {
+        enc28j60->tx_soft_fcs = 0;
+        return 0;
+    }
+    ok = enc28j60_set_rx_filter(enc28j60, 0)
+        && enc28j60_pool_init(&test_pool);
+
+    for (int path = 0; path < 3 && ok; ++path) {
+        enc28j60_stats(enc28j60, &before);
+        for (int i = 0; i < 3 && ok; ++i) {
+            test_frame(enc28j60, frame[i], 200, path * 3 + i);
+            if (i == 1) {
+                frame[i][12] = 0;
+                frame[i][13] = 100;
+            }
+            crc = enc28j60_crc32(frame[i], 196);
+            if (i == 0) {
+                crc ^= 1;
+            }
+            frame[i][196] = crc;
+            frame[i][197] = crc >> 8;
+            frame[i][198] = crc >> 16;
+            frame[i][199] = crc >> 24;
+            ok = enc28j60_send(enc28j60, frame[i], 200)
+                && enc28j60_tx_wait(enc28j60);
+        }
+        loopback_drain(enc28j60, path, 3);
+        ok = ok && rx_copy_count == 3;
+        for (int i = 0; i < 3 && ok; ++i) {
+            ok = rx_copy_size[i] == 200 
+                && memcmp(rx_copy[i], frame[i], 200) == 0;
+        }
+        ok = ok && enc28j60->stats.rx_crc_errors - before.rx_crc_errors == 1
+            && enc28j60->stats.rx_length_errors 
+                - before.rx_length_errors == 1;
+
+        // 16KB into an 8KB buffer
+        test_frame(enc28j60, flood, sizeof(flood), path);
+        for (int i = 0; i < 16 && ok; ++i) {
+            ok = enc28j60_send(enc28j60, flood, sizeof(flood))
+                && enc28j60_tx_wait(enc28j60);
+        }
+        loopback_drain(enc28j60, path, 16);
+        ok = ok && rx_copy_count > 0 && rx_copy_count < 16
+            && enc28j60->stats.rx_overflows - before.rx_overflows == 1;
+    }
+    enc28j60->tx_soft_fcs = 0;
+
+    return loopback_end(enc28j60) && ok;
+}
+
+// SPI transactions per received frame, needs frames from the network.
+int enc28j60_rx_cost_test(enc28j60_t *enc28j60, uint32_t frames)
+{
+    static uint8_t buff[1518];
+    uint32_t rx = 0, spi = 0, start;
+
+    while (rx < frames) {
+        start = enc28j60->stats.spi_transactions;
+        if (enc28j60_recv(enc28j60, buff, sizeof(buff)) > 0) {
+            spi += enc28j60->stats.spi_transactions - start;
+            ++rx;
+        }
+    }
+
+    printf("rx %u frames, %u spi transactions, %u.%02u per frame\n",
+        rx, spi, spi / rx, (spi % rx) * 100 / rx);
+
+    return 1;
+}
+
+static void batch_test_handler(enc28j60_t *enc28j60, 
+    uint8_t *data, uint32_t size)
+{
+    (void)enc28j60;
+    (void)data;
+    (void)size;
+}
+int enc28j60_rx_batch_cost_test(enc28j60_t *enc28j60, uint32_t frames)
+{
+    static uint8_t buff[1518];
+    uint32_t rx = 0, spi = 0, start, n;
+
+    while (rx < frames) {
+        start = enc28j60->stats.spi_transactions;
+        n = enc28j60_recv_batch(enc28j60, buff, sizeof(buff), 
+            batch_test_handler);
+        if (n > 0) {
+            spi += enc28j60->stats.spi_transactions - start;
+            rx += n;
+        }
+    }
+
+    printf("rx %u frames in batches, %u spi transactions, %u.%02u per frame\n",
+        rx, spi, spi / rx, (spi % rx) * 100 / rx);
+
+    return 1;
+}
+
+// Drop rate under bursts for several buffer partitions, needs a peer 
+// sending bursts of burst frames. The receiver starts delay ms late. Fails
+// if no burst starts within PEER_WAIT_MS.
+#define PEER_WAIT_MS (1000)
+int enc28j60_burst_test(enc28j60_t *enc28j60, uint32_t burst, uint32_t delay)
+{
+    static const uint16_t rings[] = { 2048, 3584, 5120, 6656 };
+    static uint8_t buff[1518];
+    uint16_t ring = enc28j60->rx_ring_size;
+    uint8_t slots = enc28j60->tx_slot_count;
+    uint32_t rx, idle;
+    int ok = 1;
+
+    for (unsigned i = 0; i < sizeof(rings)/sizeof(rings[0]) && ok; ++i) {
+        enc28j60->rx_ring_size = rings[i];
+        enc28j60->tx_slot_count = (8*1024 - rings[i]) / ENC28J60_TX_SLOT_SIZE;
+        if (!enc28j60_init(enc28j60)) {
+            return 0;
+        }
+
+        // first frame of a burst
+        for (idle = 0; enc28j60_recv(enc28j60, buff, sizeof(buff)) == 0; ) {
+            if (++idle > PEER_WAIT_MS) {
+                break;
+            }
+            delay_ms(1);
+        }
+        if (idle > PEER_WAIT_MS) {
+            printf("rx ring %u: no peer\n", rings[i]);
+            ok = 0;
+            break;
+        }
+        delay_ms(delay);
+
+        // the rest, until the line is quiet for 100ms
+        for (rx = 1, idle = 0; idle < 100; ) {
+            if (enc28j60_recv(enc28j60, buff, sizeof(buff)) > 0) {
+                ++rx;
+                idle = 0;
+            }
+            else {
+                delay_ms(1);
+                ++idle;
+            }
+        }
+
+        printf("rx ring %u, %u tx slots: %u/%u frames, %u%% dropped\n",
+            rings[i], enc28j60->tx_slot_count, rx, burst,
+            rx < burst ? (burst - rx) * 100 / burst : 0);
+    }
+
+    enc28j60->rx_ring_size = ring;
+    enc28j60->tx_slot_count = slots;
+
+    return enc28j60_init(enc28j60) && ok;
+}
+
+// The INT pin interrupt must call enc28j60_irq(). Fails if the frames stop
+// for PEER_WAIT_MS before frames came.
+int enc28j60_hybrid_test(enc28j60_t *enc28j60, uint32_t frames, 
+    uint32_t budget)
+{
+    static uint8_t buff[1518];
+    uint32_t rx = 0, n, max = 0, spi, idle = 0;
+
+    enc28j60->rx_budget = budget;
+    enc28j60->rx_idle_polls = 4;
+    enc28j60->stats.rx_poll_entries = 0;
+    enc28j60->stats.rx_poll_exits = 0;
+    if (!enc28j60_rx_interrupt(enc28j60, buff, sizeof(buff), 
+        batch_test_handler)) {
+        return 0;
+    }
+
+    spi = enc28j60->stats.spi_transactions;
+    while (rx < frames && idle <= PEER_WAIT_MS) {
+        n = enc28j60_process(enc28j60);
+        max = n > max ? n : max;
+        rx += n;
+        if (n > 0) {
+            idle = 0;
+        }
+        else if (!enc28j60->rx_polling) {
+            // nothing until the next interrupt
+            delay_ms(1);
+            ++idle;
+        }
+    }
+    spi = enc28j60->stats.spi_transactions - spi;
+    enc28j60->rx_handler = 0;
+    enc28j60->rx_budget = 0;
+    if (rx == 0) {
+        printf("budget %u: no peer\n", budget);
+        return 0;
+    }
+
+    printf("budget %u: rx %u frames, at most %u per call, %u.%02u spi "
+        "transactions per frame, polling %u/%u times\n", budget, rx, max, 
+        spi / rx, (spi % rx) * 100 / rx, enc28j60->stats.rx_poll_entries,
+        enc28j60->stats.rx_poll_exits);
+
+    return rx >= frames && (budget == 0 || max <= budget);
+}
+
+// Where the SPI time goes while receiving, needs frames from the network.
+int enc28j60_stats_test(enc28j60_t *enc28j60, uint32_t frames)
+{
+    static uint8_t buff[1518];
+    enc28j60_stats_t stats;
+    uint32_t n;
+
+    enc28j60_stats_reset(enc28j60);
+    while (enc28j60->stats.rx_frames < frames) {
+        enc28j60_recv(enc28j60, buff, sizeof(buff));
+    }
+    enc28j60_stats(enc28j60, &stats);
+
+    n = stats.rx_frames + stats.tx_frames;
+    printf("rx %u, dropped %u, crc errors %u, length errors %u, "
+        "overflows %u, tx %u, errors %u, collisions %u\n", 
+        stats.rx_frames, stats.rx_dropped, stats.rx_crc_errors,
+        stats.rx_length_errors, stats.rx_overflows, stats.tx_frames, 
+        stats.tx_errors, stats.collisions);
+    printf("spi %u transactions, %u bytes, %u retries, "
+        "%u transactions and %u bytes per frame\n", stats.spi_transactions,
+        stats.spi_bytes, stats.spi_retries, stats.spi_transactions / n, 
+        stats.spi_bytes / n);
+
+    return stats.spi_retries == 0;
+}
+
+static uint32_t crc32_bytewise(const uint8_t *data, uint32_t size)
+{
+    static uint32_t table[256];
+    uint32_t crc = 0xFFFFFFFF;
+
+    if (table[1] == 0) {
+        for (uint32_t n = 0; n < 256; ++n) {
+            crc = n;
+            for (int i = 0; i < 8; ++i) {
+                crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+            }
+            table[n] = crc;
+        }
+        crc = 0xFFFFFFFF;
+    }
+    while (size--) {
+        crc = (crc >> 8) ^ table[(crc ^ *data++) & 0xFF];
+    }
+    return ~crc;
+}
+
+// FCS throughput in MB/s over 1000 frames of 1514 bytes, against the plain
+// bytewise reference. clock_us is a free running microsecond counter.
+int enc28j60_crc_test(uint32_t (*clock_us)(void))
+{
+    static uint8_t frame[1514];
+    uint32_t t0, t1, t2, crc = 0, bytes = 1000 * sizeof(frame);
+
+    for (unsigned i = 0; i < sizeof(frame); ++i) {
+        frame[i] = i * 7;
+    }
+    if (enc28j60_crc32((uint8_t *)"123456789", 9) != 0xCBF43926
+        || enc28j60_crc32(frame, sizeof(frame)) 
+            != crc32_bytewise(frame, sizeof(frame))) {
+        return 0;
+    }
+
+    t0 = clock_us();
+    for (int i = 0; i < 1000; ++i) {
+        crc += crc32_bytewise(frame, sizeof(frame));
+    }
+    t1 = clock_us();
+    for (int i = 0; i < 1000; ++i) {
+        crc -= enc28j60_crc32(frame, sizeof(frame));
+    }
+    t2 = clock_us();
+    t1 = t1 > t0 ? t1 - t0 : 1;
+    t2 = t2 > t0 + t1 ? t2 - t0 - t1 : 1;
+
+    // 1.25MB/s on the wire at 10Mbps, a byte per microsecond is 1MB/s
+    printf("crc32 of 1514-byte frames: reference %u.%u MB/s, "
+#if defined(ENC28J60_CRC_SLICE_BY_8)
+        "slice-by-8 "
+#else
+        "bytewise "
+#endif
+        "%u.%u MB/s\n", bytes / t1, bytes * 10 / t1 % 10, 
+        bytes / t2, bytes * 10 / t2 % 10);
+
+    return crc == 0;
+}
+
+// PHY loopback benchmark, runs without a cable: round trip latency and 
+// frames/s through enc28j60_send/enc28j60_recv for several frame sizes. 
+// Against the wire time it tells whether the SPI or the network limits.
+// clock_us is a free running microsecond counter.
+int enc28j60_loopback_test(enc28j60_t *enc28j60, uint32_t (*clock_us)(void),
+    uint32_t frames)
+{
+    static const uint16_t sizes[] = { 60, 128, 256, 512, 1024, 1514 };
+    static uint8_t frame[1514], buff[1518];
+    uint32_t t0, t, lat, lat_max, elapsed, tx, rx, spi, wire;
+    int ok = 1;
+
+    enc28j60->phy_loopback = 1;
+    if (!enc28j60_init(enc28j60)) {
+        enc28j60->phy_loopback = 0;
+        return 0;
+    }
+
+    memcpy(frame, enc28j60->mac_addr, 6);
+    memcpy(frame + 6, enc28j60->mac_addr, 6);
+    frame[12] = 0x88; // local experimental ethertype
+    frame[13] = 0xB5;
+
+    for (unsigned i = 0; i < sizeof(sizes)/sizeof(sizes[0]) && ok; ++i) {
+        // latency, one frame at a time
+        lat = lat_max = 0;
+        for (rx = 0; rx < frames && ok; ++rx) {
+            t0 = clock_us();
+            enc28j60_send(enc28j60, frame, sizes[i]);
+            while (enc28j60_recv(enc28j60, buff, sizeof(buff)) == 0) {
+                if (clock_us() - t0 > 10000) {
+                    ok = 0;
+                    break;
+                }
+            }
+            t = clock_us() - t0;
+            lat += t;
+            lat_max = t > lat_max ? t : lat_max;
+        }
+
+        // throughput, the transmit slots are kept busy while receiving
+        spi = enc28j60->stats.spi_bytes;
+        t0 = clock_us();
+        for (tx = rx = 0; rx < frames && clock_us() - t0 < 1000000; ) {
+            if (tx < frames && enc28j60_send_async(enc28j60, frame, sizes[i])) {
+                ++tx;
+            }
+            if (enc28j60_recv(enc28j60, buff, sizeof(buff)) > 0) {
+                ++rx;
+            }
+        }
+        elapsed = clock_us() - t0;
+        spi = enc28j60->stats.spi_bytes - spi;
+        while (!enc28j60_tx_idle(enc28j60)) {
+            enc28j60_tx_poll(enc28j60);
+        }
+
+        // preamble, fcs and inter packet gap at 10Mbps
+        wire = (8 + sizes[i] + 4 + 12) * 8 / 10;
+        printf("%4u bytes: latency %u/%uus (avg/max), %u frames/s, "
+            "line %u frames/s, %u spi bytes per frame, %u lost\n",
+            sizes[i], frames ? lat / frames : 0, lat_max, 
+            elapsed ? (uint32_t)((uint64_t)rx * 1000000 / elapsed) : 0, 
+            1000000 / wire, rx ? spi / rx : 0, frames - rx);
+    }
+
+    enc28j60->phy_loopback = 0;
+
+    return enc28j60_init(enc28j60) && ok;
+}
+
+// Cost of the receive reset, and of a transmit recovery with nothing stuck,
+// against a full init; a frame must still go through afterwards. Runs in 
+// PHY loopback, without a cable. The faults themselves are injected by the
+// host bench.
+// clock_us is a free running microsecond counter.
+int enc28j60_recover_test(enc28j60_t *enc28j60, uint32_t (*clock_us)(void))
+{
+    static uint8_t frame[60], buff[1518];
+    uint32_t t0, t[3];
+    int ok = 1;
+
+    enc28j60->phy_loopback = 1;
+    memcpy(frame, enc28j60->mac_addr, 6);
+    memcpy(frame + 6, enc28j60->mac_addr, 6);
+    frame[12] = 0x88; // local experimental ethertype
+    frame[13] = 0xB5;
+
+    for (int i = 0; i < 3 && ok; ++i) {
+        t0 = clock_us();
+        ok = i == 0 ? enc28j60_init(enc28j60)
+            : i == 1 ? enc28j60_rx_recover(enc28j60)
+            : enc28j60_tx_recover(enc28j60);
+        t[i] = clock_us() - t0;
+
+        ok = ok && enc28j60_send(enc28j60, frame, sizeof(frame));
+        t0 = clock_us();
+        while (ok && enc28j60_recv(enc28j60, buff, sizeof(buff)) == 0) {
+            ok = clock_us() - t0 < 10000;
+        }
+    }
+    if (ok) {
+        printf("init %uus, rx reset %uus, tx recover %uus\n", 
+            t[0], t[1], t[2]);
+    }
+
+    enc28j60->phy_loopback = 0;
+
+    return enc28j60_init(enc28j60) && ok;
+}